@@ -1,8 +1,9 @@
-#version 330 core
+#version 410 core
+
+#include "uniforms.glsl"
 
 in vec4 posWorldSpace;
 in vec3 normalWorldSpace;
-in vec4 shadowCoords[8];
 in float eyeDepth;
 
 in vec2 uv;
@@ -10,20 +11,16 @@ in mat3 TBN;
 
 out vec4 fragColor;
 
-uniform float ka, kd, ks, shininess;
+uniform float shininess;
 uniform vec4 cAmbient, cDiffuse, cSpecular;
-uniform vec4 cameraPos;
 
-uniform bool fogEnabled;
 const float fog_maxdist = 10.f;
 const float fog_mindist = 0.1f;
 const vec4 fog_color = vec4(0.4f, 0.4f, 0.4f, 1.f);
 const float fog_density = 0.2f;
 
-uniform bool shadowsEnabled;
-uniform sampler2D depthTextures[8];
-
-uniform int numLights;
+// the shadow map layers of all lights, each in its tile; lookups compare depths
+uniform sampler2DShadow shadowAtlas;
 
 // texture related uniform
 struct ShapeTexture {
@@ -36,34 +33,29 @@ uniform ShapeTexture myNormals;
 uniform ShapeTexture myBumps;
 uniform float blend;
 
-/*
- * lightType: 0 = point light
- *            1 = direction light
- *            2 = spot light
- * pos: light position, defined for point lights and spot lights
- * dir: light direction, defined for direction lights and spot lights
- * attenCoeff: attenuation coefficients, defined for point lights and spot lights
- * angle: the total angle of a spot light
- * penumbra: the angle where dropoff takes place, defined for spot lights
- */
-struct Light{
-    int lightType;
-    vec4 pos;
-    vec4 dir;
-    vec4 color;
-    vec3 attenCoeff;
-    float angle;
-    float penumbra;
-};
-uniform Light lights[8];
-
 
-const float bias = 0.01;
+const float shadowBiasConstant = 0.002;
+const float shadowBiasSlope = 0.002;
+const float shadowBiasMax = 0.02;
 const float shadowVisibility = 0.5;
 
+// Poisson disk of filter taps in the unit circle; smaller kernels use its first taps
+const vec2 poissonDisk[16] = vec2[](
+    vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+    vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+    vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+    vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+    vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+    vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+    vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
 // texture helper functions
 vec4 blendDiffuseWithText();
 vec3 getNormalValue();
+float getShadowFactor(int i, vec3 dirToLight);
+float filterShadow(vec4 rect, vec2 tileCoords, float depth);
 
 void main() {
     vec4 dirToCam = normalize(cameraPos - posWorldSpace);
@@ -86,12 +78,7 @@ void main() {
         case 1: // directional light
             attenFactor = 1.0;
             dirToLight = -normalize(lights[i].dir);
-
-            if (shadowsEnabled) {
-                if (texture( depthTextures[i], shadowCoords[i].xy ).r < shadowCoords[i].z - bias) {
-                    visibility = shadowVisibility;
-                }
-            }
+            visibility = getShadowFactor(i, dirToLight.xyz);
             break;
         case 2: // spot light
             distToLight = length(posWorldSpace - lights[i].pos);
@@ -115,11 +102,7 @@ void main() {
                 attenFactor = 0;
             }
 
-            if (shadowsEnabled) {
-                if (texture( depthTextures[i], (shadowCoords[i].xy / shadowCoords[i].w) ).r < (shadowCoords[i].z - bias) / shadowCoords[i].w) {
-                    visibility = shadowVisibility;
-                }
-            }
+            visibility = getShadowFactor(i, dirToLight.xyz);
             break;
         default:
             break;
@@ -157,6 +140,67 @@ void main() {
     fragColor = mix(fog_color, illumination, fog_factor);
 }
 
+// Between shadowVisibility (fully shadowed) and 1 (lit): the fraction of filter taps that see no
+// closer surface in a shadow map of light i. Direction lights pick their cascade by view depth,
+// falling back to the next cascade for points outside the map (a cascade may still hold an older
+// position while its update is pending).
+float getShadowFactor(int i, vec3 dirToLight){
+    if (!shadowsEnabled || lights[i].shadowLayerCount == 0) {
+        return 1.0;
+    }
+
+    int first = 0;
+    if (lights[i].lightType == 1) {
+        while (first < lights[i].shadowLayerCount - 1 && eyeDepth > cascadeSplits[first]) {
+            first++;
+        }
+    }
+
+    // slope-scaled bias: surfaces at grazing angles change depth faster across a texel, and wider
+    // kernels reach further along them
+    float cosTheta = clamp(dot(normalize(normalWorldSpace), dirToLight), 0.05, 1.0);
+    float slope = sqrt(1.0 - cosTheta * cosTheta) / cosTheta;
+    float bias = min(shadowBiasConstant + shadowBiasSlope * slope * (1.0 + pcfRadius), shadowBiasMax);
+
+    for (int cascade = first; cascade < lights[i].shadowLayerCount; cascade++) {
+        int layer = lights[i].shadowLayer + cascade;
+        vec4 coords = depthBiasVPs[layer] * posWorldSpace;
+        if (coords.w <= 0) continue;
+        vec3 projected = coords.xyz / coords.w;
+        if (any(lessThan(projected.xy, vec2(0))) || any(greaterThan(projected.xy, vec2(1)))) continue;
+
+        float lit = filterShadow(atlasRects[layer], projected.xy, projected.z - bias);
+        return mix(shadowVisibility, 1.0, lit);
+    }
+    return 1.0;
+}
+
+// fraction of pcfTaps comparisons that pass, over a Poisson disk of pcfRadius texels rotated per
+// pixel so the pattern turns into fine noise instead of banding. Every tap is a hardware filtered
+// 2x2 comparison, clamped half a texel inside the tile so it never reads a neighboring one.
+float filterShadow(vec4 rect, vec2 tileCoords, float depth){
+    vec2 texel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 center = rect.xy + tileCoords * rect.zw;
+    vec2 tileMin = rect.xy + 0.5 * texel;
+    vec2 tileMax = rect.xy + rect.zw - 0.5 * texel;
+
+    int taps = clamp(pcfTaps, 1, 16);
+    if (taps == 1) {
+        return texture(shadowAtlas, vec3(clamp(center, tileMin, tileMax), depth));
+    }
+
+    // interleaved gradient noise
+    float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+
+    float lit = 0.0;
+    for (int tap = 0; tap < taps; tap++) {
+        vec2 offset = rotation * poissonDisk[tap] * pcfRadius * texel;
+        lit += texture(shadowAtlas, vec3(clamp(center + offset, tileMin, tileMax), depth));
+    }
+    return lit / float(taps);
+}
+
 vec4 blendDiffuseWithText(){
 
     vec4 diffuse = kd * cDiffuse;
@@ -1,14 +1,21 @@
-#version 330 core
+#version 410 core
+
+#include "uniforms.glsl"
 
 layout(location = 0) in vec3 posObjSpace;
 layout(location = 1) in vec3 normalObjSpace;
 layout(location = 2) in vec2 uvIn;
 layout(location = 3) in vec3 tangent;
+// per-instance transforms
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in mat3 normalMatrix;
+
+// positions may be stored quantized to the object bounds (see VertexLayout)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 out vec4 posWorldSpace;
 out vec3 normalWorldSpace;
-// positions in perspective light spaces
-out vec4 shadowCoords[8];
 // distance from camera in camera space
 out float eyeDepth;
 
@@ -16,20 +23,10 @@ out float eyeDepth;
 out vec2 uv;
 out mat3 TBN;
 
-uniform mat4 modelMatrix, viewMatrix, projectionMatrix;
-
-// bias * projection * view matrices for up to 8 shadow maps
-uniform mat4 depthBiasVPs[8];
-
 void main() {
-    posWorldSpace = modelMatrix * vec4(posObjSpace, 1.0);
-
-    mat3 modelInvTranspose = inverse(transpose(mat3(modelMatrix)));
-    normalWorldSpace = modelInvTranspose * normalObjSpace;
+    posWorldSpace = modelMatrix * vec4(positionOffset + positionScale * posObjSpace, 1.0);
 
-    for (int i = 0; i < 8; i++) {
-        shadowCoords[i] = depthBiasVPs[i] * posWorldSpace;
-    }
+    normalWorldSpace = normalMatrix * normalObjSpace;
 
     vec4 viewPos = viewMatrix * posWorldSpace;
     eyeDepth = -viewPos.z;
@@ -37,7 +34,7 @@ void main() {
     gl_Position = projectionMatrix * viewPos;
 
     uv = uvIn;
-    vec3 tangentWorldSpace = normalize(modelInvTranspose * tangent);
+    vec3 tangentWorldSpace = normalize(normalMatrix * tangent);
     //Orthogonalization to make the tangent perpendicular to the normal
     tangentWorldSpace = normalize( tangentWorldSpace - normalWorldSpace * dot(normalWorldSpace, tangentWorldSpace) );
     vec3 bitanWorldSpace = normalize(cross(normalWorldSpace, tangentWorldSpace));
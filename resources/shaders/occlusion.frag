@@ -0,0 +1,8 @@
+#version 410 core
+
+// only the samples passing the depth test matter; color writes are masked off
+out vec4 fragColor;
+
+void main() {
+    fragColor = vec4(1.0);
+}
@@ -0,0 +1,14 @@
+#version 410 core
+
+#include "uniforms.glsl"
+
+// corner of the unit cube
+layout(location = 0) in vec3 unitPos;
+
+// world-space bounds being tested
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+
+void main() {
+    gl_Position = projectionMatrix * viewMatrix * vec4(mix(boxMin, boxMax, unitPos), 1.0);
+}
@@ -1,4 +1,4 @@
-#version 330 core
+#version 410 core
 
 // output data
 // layout(location = 0) out float fragmentdepth;
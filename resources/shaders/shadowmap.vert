@@ -1,15 +1,17 @@
-#version 330 core
+#version 410 core
 
 // input vertex data, different for all executions of this shader
 layout(location = 0) in vec3 posObjSpace;
+// per-instance model matrix
+layout(location = 4) in mat4 modelMatrix;
 
 // values that stay constant for the whole mesh
 
-uniform mat4 depthProjMatrix;
-uniform mat4 depthViewMatrix;
-uniform mat4 modelMatrix;
+// positions may be stored quantized to the object bounds (see VertexLayout)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 void main() {
-    mat4 depthMVP = depthProjMatrix * depthViewMatrix * modelMatrix;
-    gl_Position = depthMVP * vec4(posObjSpace, 1);
+    // world space; shadowmap.geom projects the triangle into every light's layer
+    gl_Position = modelMatrix * vec4(positionOffset + positionScale * posObjSpace, 1);
 }
@@ -0,0 +1,59 @@
+// std140 uniform blocks shared by default.vert, default.frag and shadowmap.vert.
+// Keep in sync with the C++ mirrors in src/utils/uniformblocks.h.
+
+#define MAX_LIGHTS 8
+// shadow map layers, tiles of the shadow atlas: a cascade per directional light, one per spot light
+#define MAX_SHADOW_LAYERS 32
+#define MAX_CASCADES 4
+
+// per-frame camera, global lighting and feature flags.
+// pcfTaps and pcfRadius (in shadow map texels) set the shadow filter kernel.
+layout(std140) uniform FrameData {
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    vec4 cameraPos;
+    float ka, kd, ks;
+    int numLights;
+    bool shadowsEnabled;
+    bool fogEnabled;
+    int pcfTaps;
+    float pcfRadius;
+};
+
+/*
+ * lightType: 0 = point light
+ *            1 = direction light
+ *            2 = spot light
+ * pos: light position, defined for point lights and spot lights
+ * dir: light direction, defined for direction lights and spot lights
+ * attenCoeff: attenuation coefficients, defined for point lights and spot lights
+ * angle: the total angle of a spot light
+ * penumbra: the angle where dropoff takes place, defined for spot lights
+ * shadowLayer, shadowLayerCount: the light's shadow map layers (cascades for
+ *      direction lights); shadowLayerCount is 0 for lights without shadow maps
+ */
+struct Light {
+    vec4 pos;
+    vec4 dir;
+    vec4 color;
+    vec3 attenCoeff;
+    float angle;
+    float penumbra;
+    int lightType;
+    int shadowLayer;
+    int shadowLayerCount;
+};
+
+layout(std140) uniform LightData {
+    Light lights[MAX_LIGHTS];
+};
+
+// projection * view of every shadow map layer, and the same with the [-1,1] -> [0,1] bias applied.
+// cascadeSplits holds the view distance at which each cascade ends, and atlasRects the tile of each
+// layer in the shadow atlas (x, y, width, height in texture coordinates).
+layout(std140) uniform ShadowData {
+    mat4 lightVPs[MAX_SHADOW_LAYERS];
+    mat4 depthBiasVPs[MAX_SHADOW_LAYERS];
+    vec4 cascadeSplits;
+    vec4 atlasRects[MAX_SHADOW_LAYERS];
+};
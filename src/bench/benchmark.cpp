@@ -0,0 +1,220 @@
+#include "benchmark.h"
+
+#include <chrono>
+#include <iostream>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+
+#include "settings.h"
+
+bool OffscreenContext::create() {
+    m_context = std::make_unique<QOpenGLContext>();
+    m_context->setFormat(QSurfaceFormat::defaultFormat());
+    if (!m_context->create()) {
+        std::cerr << "could not create an OpenGL context" << std::endl;
+        return false;
+    }
+
+    m_surface = std::make_unique<QOffscreenSurface>();
+    m_surface->setFormat(m_context->format());
+    m_surface->create();
+    if (!m_surface->isValid()) {
+        std::cerr << "could not create an offscreen surface" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void OffscreenContext::makeCurrent() {
+    m_context->makeCurrent(m_surface.get());
+}
+
+void OffscreenContext::doneCurrent() {
+    m_context->doneCurrent();
+}
+
+namespace {
+
+QJsonObject toJson(const TimingSummary& summary) {
+    QJsonObject json;
+    json["samples"] = summary.samples;
+    json["mean"] = summary.average;
+    json["p50"] = summary.p50;
+    json["p95"] = summary.p95;
+    json["p99"] = summary.p99;
+    return json;
+}
+
+}
+
+Benchmark::Benchmark(const BenchmarkConfig& config)
+    : m_config(config)
+{
+}
+
+/**
+ * @brief render every scene file of the scene directory in name order.
+ * @return the configuration, the GL renderer and the results keyed by scene file name
+ */
+QJsonObject Benchmark::run(OffscreenContext& context) {
+    m_context = &context;
+
+    settings.shapeParameter1 = m_config.shapeParameter1;
+    settings.shapeParameter2 = m_config.shapeParameter2;
+    settings.nearPlane = 0.1f;
+    settings.farPlane = 10.f;
+    settings.extraCredit1 = m_config.shadows;
+    settings.extraCredit2 = m_config.fog;
+
+    m_renderer.init(m_context);
+    m_context->makeCurrent();
+    createFramebuffer();
+
+    QJsonObject config;
+    config["frames"] = m_config.frames;
+    config["warmupFrames"] = m_config.warmupFrames;
+    config["width"] = m_config.width;
+    config["height"] = m_config.height;
+    config["shapeParameter1"] = m_config.shapeParameter1;
+    config["shapeParameter2"] = m_config.shapeParameter2;
+    config["shadows"] = m_config.shadows;
+    config["fog"] = m_config.fog;
+
+    QJsonObject result;
+    result["config"] = config;
+    result["renderer"] = QString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    result["version"] = QString(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+    QDir sceneDirectory(QString::fromStdString(m_config.sceneDirectory));
+    QStringList sceneFiles = sceneDirectory.entryList({"*.json"}, QDir::Files, QDir::Name);
+    if (sceneFiles.isEmpty()) {
+        std::cerr << "no scene files in " << m_config.sceneDirectory << std::endl;
+    }
+
+    QJsonObject scenes;
+    for (const QString& sceneFile : sceneFiles) {
+        std::cerr << "benchmarking " << sceneFile.toStdString() << std::endl;
+        scenes[sceneFile] = runScene(sceneDirectory.filePath(sceneFile).toStdString());
+    }
+    result["scenes"] = scenes;
+
+    m_context->makeCurrent();
+    deleteFramebuffer();
+    m_renderer.finish();
+    return result;
+}
+
+/**
+ * @brief load one scene and time its frames along the camera path. The path is resampled to the
+ *      configured frame count, so every run renders the same poses whatever the path's timestep.
+ *      A frame count of 0 renders every path frame once, as the interactive replay does.
+ */
+QJsonObject Benchmark::runScene(const std::string& sceneFile) {
+    settings.sceneFilePath = sceneFile;
+    m_renderer.loadScene();
+    m_renderer.settingsChanged();
+    m_renderer.resize(m_config.width, m_config.height);
+    // loading and resizing release the context when they are done
+    m_context->makeCurrent();
+
+    CameraPath path = loadCameraPath(sceneFile);
+    int frameCount = m_config.frames > 0 ? m_config.frames : path.getFrameCount();
+    Camera& camera = m_renderer.getCamera();
+    auto setPose = [&](int frame) {
+        float t = frameCount > 1 ? (float)frame / (frameCount - 1) : 0.f;
+        CameraPose pose = path.sample(t * path.getDuration());
+        camera.setPose(pose.pos, pose.look, pose.up);
+    };
+
+    for (int frame = 0; frame < m_config.warmupFrames; frame++) {
+        setPose(frame % frameCount);
+        m_renderer.render(m_framebuffer);
+        glFinish();
+    }
+
+    std::vector<float> frameTimes;
+    frameTimes.reserve(frameCount);
+    double drawCalls = 0.0;
+    double triangles = 0.0;
+    for (int frame = 0; frame < frameCount; frame++) {
+        setPose(frame);
+        auto start = std::chrono::steady_clock::now();
+        m_renderer.render(m_framebuffer);
+        glFinish();
+        frameTimes.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        // counters of the frame that just completed
+        const RenderStats& stats = m_renderer.getRenderStats();
+        drawCalls += stats.drawCalls;
+        triangles += stats.triangles;
+    }
+
+    QJsonObject result;
+    result["frames"] = frameCount;
+    result["frameTime"] = toJson(Profiler::summarizeSamples(frameTimes));
+    result["drawCalls"] = drawCalls / frameCount;
+    result["triangles"] = triangles / frameCount;
+
+    // the profiler keeps the last Profiler::WINDOW_SIZE samples of each pass
+    QJsonObject cpuSections, gpuSections;
+    for (const TimingSummary& summary : m_renderer.getProfiler().summarize()) {
+        (summary.gpu ? gpuSections : cpuSections)[QString::fromStdString(summary.name)] = toJson(summary);
+    }
+    result["cpu"] = cpuSections;
+    result["gpu"] = gpuSections;
+    return result;
+}
+
+/**
+ * @brief the configured path file, the scene's file in the configured path directory, or a turn
+ *      around the scene camera when neither exists.
+ */
+CameraPath Benchmark::loadCameraPath(const std::string& sceneFile) {
+    CameraPath path;
+    if (!m_config.cameraPath.empty()) {
+        QFileInfo pathInfo(QString::fromStdString(m_config.cameraPath));
+        QString pathFile = pathInfo.filePath();
+        if (pathInfo.isDir()) {
+            pathFile = QDir(pathInfo.filePath()).filePath(QFileInfo(QString::fromStdString(sceneFile)).fileName());
+        }
+        if (QFileInfo::exists(pathFile) && path.load(pathFile.toStdString())) {
+            return path;
+        }
+    }
+
+    Camera& camera = m_renderer.getCamera();
+    SceneCameraData cameraData;
+    cameraData.pos = camera.getPos();
+    cameraData.look = glm::vec4(camera.getLook(), 0.f);
+    cameraData.up = glm::vec4(camera.getUp(), 0.f);
+    return CameraPath::turnAround(cameraData, m_config.frames > 0 ? m_config.frames : 360, 1.f / 60.f);
+}
+
+void Benchmark::createFramebuffer() {
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_config.width, m_config.height);
+
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_config.width, m_config.height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "benchmark framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Benchmark::deleteFramebuffer() {
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteRenderbuffers(1, &m_colorBuffer);
+    glDeleteRenderbuffers(1, &m_depthBuffer);
+    m_framebuffer = m_colorBuffer = m_depthBuffer = 0;
+}
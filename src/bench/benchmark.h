@@ -0,0 +1,71 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#include "render/renderer.h"
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <memory>
+#include <string>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include "camera/camerapath.h"
+#include "utils/glcontext.h"
+
+// A context without a window, rendering into framebuffers only.
+class OffscreenContext : public GLContext
+{
+public:
+    // uses the default QSurfaceFormat
+    bool create();
+    void makeCurrent() override;
+    void doneCurrent() override;
+
+private:
+    std::unique_ptr<QOpenGLContext> m_context;
+    std::unique_ptr<QOffscreenSurface> m_surface;
+};
+
+struct BenchmarkConfig {
+    std::string sceneDirectory = "scenefiles";
+    // a path file used for every scene, or a directory holding <scene name>.json per scene;
+    // scenes without a path turn around once at their camera
+    std::string cameraPath;
+    int frames = 300;                                   // 0 renders each frame of the path once
+    int warmupFrames = 10;
+    int width = 800;
+    int height = 600;
+    int shapeParameter1 = 5;
+    int shapeParameter2 = 5;
+    bool shadows = false;
+    bool fog = false;
+};
+
+// Renders every scene of a directory along a camera path at a fixed resolution and settings,
+// timing each frame from the start of its commands to glFinish.
+class Benchmark
+{
+public:
+    explicit Benchmark(const BenchmarkConfig& config);
+
+    // context must be current; the result holds the configuration and one entry per scene
+    QJsonObject run(OffscreenContext& context);
+
+private:
+    QJsonObject runScene(const std::string& sceneFile);
+    CameraPath loadCameraPath(const std::string& sceneFile);
+    void createFramebuffer();
+    void deleteFramebuffer();
+
+    BenchmarkConfig m_config;
+    OffscreenContext* m_context = nullptr;
+    Renderer m_renderer;
+
+    GLuint m_framebuffer = 0;
+    GLuint m_colorBuffer = 0;
+    GLuint m_depthBuffer = 0;
+};
@@ -0,0 +1,83 @@
+#include "benchmark.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonDocument>
+#include <QSurfaceFormat>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+// Renders the scene files without a window and prints the timings as JSON.
+// Under Mesa, LIBGL_ALWAYS_SOFTWARE=1 selects llvmpipe.
+int main(int argc, char *argv[]) {
+    // run on machines without a display unless a platform was chosen explicitly
+    if (!std::getenv("QT_QPA_PLATFORM") && !std::getenv("DISPLAY") && !std::getenv("WAYLAND_DISPLAY")) {
+        setenv("QT_QPA_PLATFORM", "offscreen", 1);
+    }
+    QGuiApplication a(argc, argv);
+
+    QCoreApplication::setApplicationName("Project 5: Realtime Benchmark");
+    QCoreApplication::setOrganizationName("CS 1230");
+    QCoreApplication::setApplicationVersion(QT_VERSION_STR);
+
+    BenchmarkConfig config;
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders every scene file along a camera path and reports frame times as JSON.");
+    parser.addHelpOption();
+    QCommandLineOption scenesOption("scenes", "Directory of scene files.", "dir", QString::fromStdString(config.sceneDirectory));
+    QCommandLineOption pathOption("path", "Camera path file, or a directory of <scene file name> paths. "
+                                          "Scenes without a path turn around at their camera.", "path");
+    QCommandLineOption framesOption("frames", "Measured frames per scene, 0 for one per camera path frame.", "n", QString::number(config.frames));
+    QCommandLineOption warmupOption("warmup", "Unmeasured frames rendered first.", "n", QString::number(config.warmupFrames));
+    QCommandLineOption widthOption("width", "Framebuffer width.", "pixels", QString::number(config.width));
+    QCommandLineOption heightOption("height", "Framebuffer height.", "pixels", QString::number(config.height));
+    QCommandLineOption tessellationOption("tessellation", "Shape parameters 1 and 2.", "n", QString::number(config.shapeParameter1));
+    QCommandLineOption shadowsOption("shadows", "Render shadow maps.");
+    QCommandLineOption fogOption("fog", "Render fog.");
+    QCommandLineOption outputOption("output", "Write the JSON to a file instead of standard output.", "file");
+    parser.addOptions({scenesOption, pathOption, framesOption, warmupOption, widthOption, heightOption,
+                       tessellationOption, shadowsOption, fogOption, outputOption});
+    parser.process(a);
+
+    config.sceneDirectory = parser.value(scenesOption).toStdString();
+    config.cameraPath = parser.value(pathOption).toStdString();
+    config.frames = std::max(parser.value(framesOption).toInt(), 0);
+    config.warmupFrames = std::max(parser.value(warmupOption).toInt(), 0);
+    config.width = std::max(parser.value(widthOption).toInt(), 1);
+    config.height = std::max(parser.value(heightOption).toInt(), 1);
+    config.shapeParameter1 = config.shapeParameter2 = std::max(parser.value(tessellationOption).toInt(), 1);
+    config.shadows = parser.isSet(shadowsOption);
+    config.fog = parser.isSet(fogOption);
+
+    QSurfaceFormat fmt;
+    fmt.setVersion(4, 1);
+    fmt.setProfile(QSurfaceFormat::CoreProfile);
+    QSurfaceFormat::setDefaultFormat(fmt);
+
+    OffscreenContext context;
+    if (!context.create()) {
+        return 1;
+    }
+    context.makeCurrent();
+
+    // the renderer logs to standard output, which is kept for the results
+    std::streambuf* coutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+    Benchmark benchmark(config);
+    QJsonObject result = benchmark.run(context);
+    std::cout.rdbuf(coutBuffer);
+
+    QByteArray json = QJsonDocument(result).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QFile::WriteOnly)) {
+            std::cerr << "could not write " << parser.value(outputOption).toStdString() << std::endl;
+            return 1;
+        }
+        file.write(json);
+    } else {
+        std::cout << json.toStdString();
+    }
+    return 0;
+}
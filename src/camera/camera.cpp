@@ -129,6 +129,21 @@ glm::vec4 Camera::getPos() const {
     return glm::vec4{m_pos, 1.f};
 }
 
+glm::vec3 Camera::getLook() const {
+    return m_look;
+}
+
+glm::vec3 Camera::getUp() const {
+    return m_up;
+}
+
+void Camera::setPose(const glm::vec3& pos, const glm::vec3& look, const glm::vec3& up) {
+    m_pos = pos;
+    m_look = look;
+    m_up = up;
+    computeViewMatrix();
+}
+
 float Camera::getWidth() const {
     return m_width;
 }
@@ -43,6 +43,11 @@ public:
 
     // Return the position of the camera in world space.
     glm::vec4 getPos() const;
+    glm::vec3 getLook() const;
+    glm::vec3 getUp() const;
+
+    // Place the camera directly, e.g. on a frame of a camera path.
+    void setPose(const glm::vec3& pos, const glm::vec3& look, const glm::vec3& up);
 
     float getWidth() const;
     float getHeight() const;
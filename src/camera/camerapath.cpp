@@ -0,0 +1,156 @@
+#include "camerapath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+
+QJsonArray toJson(const glm::vec3& v) {
+    return QJsonArray{v.x, v.y, v.z};
+}
+
+bool parseVec3(const QJsonValue& value, glm::vec3& result) {
+    QJsonArray array = value.toArray();
+    if (array.size() != 3) {
+        return false;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (!array[i].isDouble()) {
+            return false;
+        }
+        result[i] = array[i].toDouble();
+    }
+    return true;
+}
+
+}
+
+/**
+ * @brief read a path written by the recorder (or by hand).
+ * @return false if the file cannot be read or has no valid frames
+ */
+bool CameraPath::load(const std::string& filePath) {
+    m_frames.clear();
+
+    QFile file(QString::fromStdString(filePath));
+    if (!file.open(QFile::ReadOnly)) {
+        std::cerr << "could not open camera path " << filePath << std::endl;
+        return false;
+    }
+
+    QJsonParseError jsonError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &jsonError);
+    if (!doc.isObject()) {
+        std::cerr << "could not parse camera path " << filePath << ": " << jsonError.errorString().toStdString() << std::endl;
+        return false;
+    }
+
+    QJsonObject root = doc.object();
+    if (root["timestep"].isDouble() && root["timestep"].toDouble() > 0.0) {
+        m_timestep = root["timestep"].toDouble();
+    }
+
+    QJsonArray frames = root["frames"].toArray();
+    for (int i = 0; i < frames.size(); i++) {
+        QJsonObject frame = frames[i].toObject();
+        CameraPose pose;
+        if (!parseVec3(frame["pos"], pose.pos) || !parseVec3(frame["look"], pose.look) || !parseVec3(frame["up"], pose.up)) {
+            std::cerr << "camera path " << filePath << ": frame " << i << " needs pos, look and up as [x, y, z]" << std::endl;
+            m_frames.clear();
+            return false;
+        }
+        m_frames.push_back(pose);
+    }
+
+    if (m_frames.empty()) {
+        std::cerr << "camera path " << filePath << " has no frames" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CameraPath::save(const std::string& filePath) const {
+    QJsonArray frames;
+    for (const CameraPose& pose : m_frames) {
+        QJsonObject frame;
+        frame["pos"] = toJson(pose.pos);
+        frame["look"] = toJson(pose.look);
+        frame["up"] = toJson(pose.up);
+        frames.append(frame);
+    }
+    QJsonObject root;
+    root["timestep"] = m_timestep;
+    root["frames"] = frames;
+
+    QFile file(QString::fromStdString(filePath));
+    if (!file.open(QFile::WriteOnly)) {
+        std::cerr << "could not write camera path " << filePath << std::endl;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+void CameraPath::clear(float timestep) {
+    m_timestep = timestep;
+    m_frames.clear();
+}
+
+void CameraPath::addFrame(const CameraPose& pose) {
+    m_frames.push_back(pose);
+}
+
+CameraPath CameraPath::turnAround(const SceneCameraData& cameraData, int frameCount, float timestep) {
+    CameraPath path;
+    path.m_timestep = timestep;
+    for (int frame = 0; frame < frameCount; frame++) {
+        float angle = 2.f * M_PI * frame / std::max(frameCount - 1, 1);
+        float c = std::cos(angle), s = std::sin(angle);
+        auto rotate = [&](const glm::vec3& v) {
+            return glm::vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+        };
+        path.m_frames.push_back({glm::vec3(cameraData.pos), rotate(glm::vec3(cameraData.look)), rotate(glm::vec3(cameraData.up))});
+    }
+    return path;
+}
+
+bool CameraPath::empty() const {
+    return m_frames.empty();
+}
+
+int CameraPath::getFrameCount() const {
+    return m_frames.size();
+}
+
+float CameraPath::getTimestep() const {
+    return m_timestep;
+}
+
+float CameraPath::getDuration() const {
+    return m_frames.empty() ? 0.f : (m_frames.size() - 1) * m_timestep;
+}
+
+/**
+ * @brief blend the two frames around a time. Directions are interpolated linearly and renormalized,
+ *      which is close enough to a rotation for the small steps between recorded frames.
+ */
+CameraPose CameraPath::sample(float time) const {
+    float position = std::clamp(time / m_timestep, 0.f, (float)m_frames.size() - 1.f);
+    int frame = std::min((int)position, (int)m_frames.size() - 1);
+    int next = std::min(frame + 1, (int)m_frames.size() - 1);
+    float t = position - frame;
+
+    const CameraPose& a = m_frames[frame];
+    const CameraPose& b = m_frames[next];
+    return CameraPose{
+        glm::mix(a.pos, b.pos, t),
+        glm::normalize(glm::mix(a.look, b.look, t)),
+        glm::normalize(glm::mix(a.up, b.up, t))
+    };
+}
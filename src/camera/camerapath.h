@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "utils/scenedata.h"
+
+// placement of the camera in one frame
+struct CameraPose {
+    glm::vec3 pos;
+    glm::vec3 look;
+    glm::vec3 up;
+};
+
+// Camera poses taken at a fixed timestep. Stored as JSON:
+//     { "timestep": 0.0166667, "frames": [ { "pos": [x, y, z], "look": [x, y, z], "up": [x, y, z] }, ... ] }
+class CameraPath {
+public:
+    bool load(const std::string& filePath);
+    bool save(const std::string& filePath) const;
+
+    // drops the frames and starts a path at a new timestep
+    void clear(float timestep);
+    void addFrame(const CameraPose& pose);
+
+    // a full turn about the vertical axis, standing at the scene camera
+    static CameraPath turnAround(const SceneCameraData& cameraData, int frameCount, float timestep);
+
+    bool empty() const;
+    int getFrameCount() const;
+    // seconds between frames
+    float getTimestep() const;
+    // seconds from the first to the last frame
+    float getDuration() const;
+    // pose at a time in seconds, interpolated between frames and clamped to the path
+    CameraPose sample(float time) const;
+
+private:
+    float m_timestep = 1.f / 60.f;
+    std::vector<CameraPose> m_frames;
+};
@@ -39,6 +39,19 @@ void MainWindow::initialize() {
     QLabel *ec_label = new QLabel(); // Extra Credit label
     ec_label->setText("Extra Credit");
     ec_label->setFont(font);
+    QLabel *cascades_label = new QLabel(); // Shadow cascades label
+    cascades_label->setText("Shadow Cascades:");
+    QLabel *cascadeSplit_label = new QLabel(); // Cascade split label
+    cascadeSplit_label->setText("Cascade Split (0 = uniform, 1 = log):");
+    QLabel *shadowFilterTaps_label = new QLabel(); // Shadow filter taps label
+    shadowFilterTaps_label->setText("Shadow Filter Taps:");
+    QLabel *shadowFilterRadius_label = new QLabel(); // Shadow filter radius label
+    shadowFilterRadius_label->setText("Shadow Filter Radius (texels):");
+    QLabel *performance_label = new QLabel(); // Performance label
+    performance_label->setText("Performance");
+    QLabel *frameRate_label = new QLabel(); // Frame rate limit label
+    frameRate_label->setText("Frame Rate Limit (0 = display):");
+    performance_label->setFont(font);
     QLabel *param1_label = new QLabel(); // Parameter 1 label
     param1_label->setText("Parameter 1:");
     QLabel *param2_label = new QLabel(); // Parameter 2 label
@@ -151,6 +164,28 @@ void MainWindow::initialize() {
     ec1->setText(QStringLiteral("Shadows"));
     ec1->setChecked(false);
 
+    cascadesBox = new QSpinBox();
+    cascadesBox->setMinimum(1);
+    cascadesBox->setMaximum(4);
+    cascadesBox->setValue(settings.shadowCascades);
+
+    cascadeSplitBox = new QDoubleSpinBox();
+    cascadeSplitBox->setMinimum(0.f);
+    cascadeSplitBox->setMaximum(1.f);
+    cascadeSplitBox->setSingleStep(0.05f);
+    cascadeSplitBox->setValue(settings.cascadeSplitBlend);
+
+    shadowFilterTapsBox = new QSpinBox();
+    shadowFilterTapsBox->setMinimum(1);
+    shadowFilterTapsBox->setMaximum(16);
+    shadowFilterTapsBox->setValue(settings.shadowFilterTaps);
+
+    shadowFilterRadiusBox = new QDoubleSpinBox();
+    shadowFilterRadiusBox->setMinimum(0.f);
+    shadowFilterRadiusBox->setMaximum(4.f);
+    shadowFilterRadiusBox->setSingleStep(0.25f);
+    shadowFilterRadiusBox->setValue(settings.shadowFilterRadius);
+
     ec2 = new QCheckBox();
     ec2->setText(QStringLiteral("Fog"));
     ec2->setChecked(false);
@@ -163,6 +198,41 @@ void MainWindow::initialize() {
     ec4->setText(QStringLiteral("Extra Credit 4"));
     ec4->setChecked(false);
 
+    // Performance:
+    occlusionCulling = new QCheckBox();
+    occlusionCulling->setText(QStringLiteral("Occlusion Culling"));
+    occlusionCulling->setChecked(false);
+
+    softwareOcclusion = new QCheckBox();
+    softwareOcclusion->setText(QStringLiteral("Software Occlusion Culling"));
+    softwareOcclusion->setChecked(false);
+
+    staticBatching = new QCheckBox();
+    staticBatching->setText(QStringLiteral("Static Batching"));
+    staticBatching->setChecked(false);
+    staticBatching->setToolTip(QStringLiteral("Merges static shapes into world-space chunks. Batched shapes are "
+                                              "always drawn at their finest level of detail, in the shadow "
+                                              "passes too, and are not occlusion culled."));
+
+    frameRateBox = new QSpinBox();
+    frameRateBox->setMinimum(0);
+    frameRateBox->setMaximum(240);
+    frameRateBox->setSingleStep(10);
+    frameRateBox->setValue(0);
+
+    performanceOverlay = new QCheckBox();
+    performanceOverlay->setText(QStringLiteral("Performance Overlay"));
+    performanceOverlay->setChecked(false);
+
+    recordTimings = new QPushButton();
+    recordTimings->setText(QStringLiteral("Record Timings (CSV)"));
+
+    recordCameraPath = new QPushButton();
+    recordCameraPath->setText(QStringLiteral("Record Camera Path"));
+
+    replayCameraPath = new QPushButton();
+    replayCameraPath->setText(QStringLiteral("Replay Camera Path"));
+
     vLayout->addWidget(uploadFile);
     vLayout->addWidget(saveImage);
     vLayout->addWidget(tesselation_label);
@@ -184,10 +254,30 @@ void MainWindow::initialize() {
     // Extra Credit:
     vLayout->addWidget(ec_label);
     vLayout->addWidget(ec1);
+    vLayout->addWidget(cascades_label);
+    vLayout->addWidget(cascadesBox);
+    vLayout->addWidget(cascadeSplit_label);
+    vLayout->addWidget(cascadeSplitBox);
+    vLayout->addWidget(shadowFilterTaps_label);
+    vLayout->addWidget(shadowFilterTapsBox);
+    vLayout->addWidget(shadowFilterRadius_label);
+    vLayout->addWidget(shadowFilterRadiusBox);
     vLayout->addWidget(ec2);
     vLayout->addWidget(ec3);
     vLayout->addWidget(ec4);
 
+    // Performance:
+    vLayout->addWidget(performance_label);
+    vLayout->addWidget(occlusionCulling);
+    vLayout->addWidget(softwareOcclusion);
+    vLayout->addWidget(staticBatching);
+    vLayout->addWidget(frameRate_label);
+    vLayout->addWidget(frameRateBox);
+    vLayout->addWidget(performanceOverlay);
+    vLayout->addWidget(recordTimings);
+    vLayout->addWidget(recordCameraPath);
+    vLayout->addWidget(replayCameraPath);
+
     connectUIElements();
 
     // Set default values of 5 for tesselation parameters
@@ -215,6 +305,7 @@ void MainWindow::connectUIElements() {
     connectNear();
     connectFar();
     connectExtraCredit();
+    connectPerformance();
 }
 
 
@@ -260,11 +351,31 @@ void MainWindow::connectFar() {
 
 void MainWindow::connectExtraCredit() {
     connect(ec1, &QCheckBox::clicked, this, &MainWindow::onExtraCredit1);
+    connect(cascadesBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeCascades);
+    connect(cascadeSplitBox, static_cast<void(QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            this, &MainWindow::onValChangeCascadeSplit);
+    connect(shadowFilterTapsBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeShadowFilterTaps);
+    connect(shadowFilterRadiusBox, static_cast<void(QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            this, &MainWindow::onValChangeShadowFilterRadius);
     connect(ec2, &QCheckBox::clicked, this, &MainWindow::onExtraCredit2);
     connect(ec3, &QCheckBox::clicked, this, &MainWindow::onExtraCredit3);
     connect(ec4, &QCheckBox::clicked, this, &MainWindow::onExtraCredit4);
 }
 
+void MainWindow::connectPerformance() {
+    connect(occlusionCulling, &QCheckBox::clicked, this, &MainWindow::onOcclusionCulling);
+    connect(softwareOcclusion, &QCheckBox::clicked, this, &MainWindow::onSoftwareOcclusion);
+    connect(staticBatching, &QCheckBox::clicked, this, &MainWindow::onStaticBatching);
+    connect(frameRateBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeFrameRate);
+    connect(performanceOverlay, &QCheckBox::clicked, this, &MainWindow::onPerformanceOverlay);
+    connect(recordTimings, &QPushButton::clicked, this, &MainWindow::onRecordTimings);
+    connect(recordCameraPath, &QPushButton::clicked, this, &MainWindow::onRecordCameraPath);
+    connect(replayCameraPath, &QPushButton::clicked, this, &MainWindow::onReplayCameraPath);
+}
+
 // From old Project 6
 // void MainWindow::onPerPixelFilter() {
 //     settings.perPixelFilter = !settings.perPixelFilter;
@@ -367,6 +478,26 @@ void MainWindow::onExtraCredit1() {
     realtime->settingsChanged();
 }
 
+void MainWindow::onValChangeCascades(int newValue) {
+    settings.shadowCascades = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeCascadeSplit(double newValue) {
+    settings.cascadeSplitBlend = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeShadowFilterTaps(int newValue) {
+    settings.shadowFilterTaps = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeShadowFilterRadius(double newValue) {
+    settings.shadowFilterRadius = newValue;
+    realtime->settingsChanged();
+}
+
 void MainWindow::onExtraCredit2() {
     settings.extraCredit2 = !settings.extraCredit2;
     realtime->settingsChanged();
@@ -381,3 +512,76 @@ void MainWindow::onExtraCredit4() {
     settings.extraCredit4 = !settings.extraCredit4;
     realtime->settingsChanged();
 }
+
+// Performance:
+
+void MainWindow::onOcclusionCulling() {
+    settings.occlusionCulling = !settings.occlusionCulling;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onSoftwareOcclusion() {
+    settings.softwareOcclusion = !settings.softwareOcclusion;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onStaticBatching() {
+    settings.staticBatching = !settings.staticBatching;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeFrameRate(int newValue) {
+    settings.targetFrameRate = newValue;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onPerformanceOverlay() {
+    settings.performanceOverlay = !settings.performanceOverlay;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onRecordTimings() {
+    if (realtime->isWritingTimingCsv()) {
+        realtime->stopTimingCsv();
+        recordTimings->setText(QStringLiteral("Record Timings (CSV)"));
+        return;
+    }
+
+    QString filePath = QFileDialog::getSaveFileName(this, tr("Record Timings"),
+                                                    QDir::currentPath()
+                                                        .append(QDir::separator())
+                                                        .append("timings.csv"), tr("CSV Files (*.csv)"));
+    if (filePath.isNull()) {
+        return;
+    }
+    if (realtime->startTimingCsv(filePath.toStdString())) {
+        recordTimings->setText(QStringLiteral("Stop Recording Timings"));
+    }
+}
+
+void MainWindow::onRecordCameraPath() {
+    if (realtime->isRecordingCamera()) {
+        realtime->stopCameraRecording();
+        recordCameraPath->setText(QStringLiteral("Record Camera Path"));
+        return;
+    }
+
+    QString filePath = QFileDialog::getSaveFileName(this, tr("Record Camera Path"),
+                                                    QDir::currentPath()
+                                                        .append(QDir::separator())
+                                                        .append("camerapath.json"), tr("Camera Paths (*.json)"));
+    if (filePath.isNull()) {
+        return;
+    }
+    realtime->startCameraRecording(filePath.toStdString());
+    recordCameraPath->setText(QStringLiteral("Stop Recording Camera Path"));
+}
+
+void MainWindow::onReplayCameraPath() {
+    QString filePath = QFileDialog::getOpenFileName(this, tr("Replay Camera Path"),
+                                                    QDir::currentPath(), tr("Camera Paths (*.json)"));
+    if (filePath.isNull()) {
+        return;
+    }
+    realtime->startCameraReplay(filePath.toStdString());
+}
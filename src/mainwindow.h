@@ -31,6 +31,7 @@ private:
     void connectUploadFile();
     void connectSaveImage();
     void connectExtraCredit();
+    void connectPerformance();
 
     Realtime *realtime;
     AspectRatioWidget *aspectRatioWidget;
@@ -52,10 +53,24 @@ private:
 
     // Extra Credit:
     QCheckBox *ec1;
+    QSpinBox *cascadesBox;
+    QDoubleSpinBox *cascadeSplitBox;
+    QSpinBox *shadowFilterTapsBox;
+    QDoubleSpinBox *shadowFilterRadiusBox;
     QCheckBox *ec2;
     QCheckBox *ec3;
     QCheckBox *ec4;
 
+    // Performance:
+    QCheckBox *occlusionCulling;
+    QCheckBox *softwareOcclusion;
+    QCheckBox *staticBatching;
+    QSpinBox *frameRateBox;
+    QCheckBox *performanceOverlay;
+    QPushButton *recordTimings;
+    QPushButton *recordCameraPath;
+    QPushButton *replayCameraPath;
+
 private slots:
     // From old Project 6
     // void onPerPixelFilter();
@@ -72,7 +87,21 @@ private slots:
 
     // Extra Credit:
     void onExtraCredit1();
+    void onValChangeCascades(int newValue);
+    void onValChangeCascadeSplit(double newValue);
+    void onValChangeShadowFilterTaps(int newValue);
+    void onValChangeShadowFilterRadius(double newValue);
     void onExtraCredit2();
     void onExtraCredit3();
     void onExtraCredit4();
+
+    // Performance:
+    void onOcclusionCulling();
+    void onSoftwareOcclusion();
+    void onStaticBatching();
+    void onValChangeFrameRate(int newValue);
+    void onPerformanceOverlay();
+    void onRecordTimings();
+    void onRecordCameraPath();
+    void onReplayCameraPath();
 };
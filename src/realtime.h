@@ -11,12 +11,27 @@
 #include <unordered_map>
 #include <iostream>
 #include <QElapsedTimer>
+#include <QLabel>
 #include <QOpenGLWidget>
 #include <QTime>
 #include <QTimer>
 
-#include "utils/sceneparser.h"
-#include "camera/camera.h"
+#include "utils/glcontext.h"
+#include "camera/camerapath.h"
+#include "render/framescheduler.h"
+#include "render/renderer.h"
+
+// the context of a QOpenGLWidget, for the renderer's loading and teardown
+class WidgetContext : public GLContext
+{
+public:
+    explicit WidgetContext(QOpenGLWidget* widget) : m_widget(widget) {}
+    void makeCurrent() override { m_widget->makeCurrent(); }
+    void doneCurrent() override { m_widget->doneCurrent(); }
+
+private:
+    QOpenGLWidget* m_widget;
+};
 
 class Realtime : public QOpenGLWidget
 {
@@ -27,8 +42,22 @@ public:
     void settingsChanged();
     void saveViewportImage(std::string filePath);
 
-public slots:
-    void tick(QTimerEvent* event);                      // Called once per tick of m_timer
+    // draw / bind counters of the last complete frame
+    const RenderStats& getRenderStats() const;
+    // main pass shapes drawn / rejected by occlusion culling in the last frame
+    const CullStats& getOcclusionCullStats() const;
+
+    // stream every CPU and GPU timing sample to a CSV file until stopTimingCsv
+    bool startTimingCsv(std::string filePath);
+    void stopTimingCsv();
+    bool isWritingTimingCsv();
+
+    // sample the camera every recordTimestep seconds until stopCameraRecording writes the path
+    void startCameraRecording(std::string filePath);
+    bool stopCameraRecording();
+    bool isRecordingCamera() const;
+    // drive the camera along a recorded path, one path frame per rendered frame, ignoring input
+    bool startCameraReplay(std::string filePath);
 
 protected:
     void initializeGL() override;                       // Called once at the start of the program
@@ -41,11 +70,16 @@ private:
     void mousePressEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
-    void timerEvent(QTimerEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+    void pickShape(float x, float y);
 
     // Tick Related Variables
-    int m_timer;                                        // Stores timer which attempts to run ~60 times per second
-    QElapsedTimer m_elapsedTimer;                       // Stores timer which keeps track of actual time between frames
+    FrameScheduler m_frameScheduler;                    // Ticks only while a frame was requested or keys are held
+    void tick(float deltaTime);                         // Called by m_frameScheduler before each frame
+    bool isMoving();                                    // whether a movement key is held
+    void updateContinuous();                            // tick every frame while moving, recording or replaying
+    float prevTargetFrameRate = -1;
 
     // Input Related Variables
     bool m_mouseDown = false;                           // Stores state of left mouse button
@@ -55,47 +89,23 @@ private:
     // Device Correction Variables
     double m_devicePixelRatio;
 
-
-    RenderData m_renderData;
-    SceneParser m_sceneParser;
-    ShapeManager m_shapeManager;
-    bool m_sceneLoaded = false;
-    void parseScene();
-    void updateShapeVertices();
-    Camera m_camera;
-
-    float prevNearPlane = -1;
-    float prevFarPlane = -1;
-    int prevParam1 = -1;
-    int prevParam2 = -1;
-    bool prevShadowsEnabled = false;
-
-
-    GLuint m_default_shader;
-    GLuint m_shadowmap_shader;
-
-    void shadowMap(const SceneLightData& lightData, int lightIndex);
-    bool m_haveMadeFBO = false;
-    void makeFBO();
-
-    const static int numShadowMaps = 8;
-    GLuint m_depthTextures[numShadowMaps];
-    GLuint m_shadowFBO;
-    // int shadowWidth = 1024;
-    // int shadowHeight = 1024;
-    int shadowWidth = 2048;
-    int shadowHeight = 2048;
-
-    glm::mat4 m_lightOrthoMatrix;
-    glm::mat4 m_lightPerspectiveMatrix;
-    glm::mat4 m_biasMatrix;
-    float dirLightPosOffset = 10.f;
-    glm::mat4 getLightViewMatrix(const glm::vec3& lightPos, const glm::vec3& lightInvDir, bool isSpotLight);
-
-    // textures
-    std::unordered_map<std::string, GLuint> m_textures; // hash for texture filename and texture id
-    std::unordered_map<std::string, GLuint> m_normalTextures; // hash for normal texture filename and normal texture id
-    std::unordered_map<std::string, GLuint> m_bumpTextures; // hash for bump texture filename and bump texture id
-    void createTextureAndNormal();
-    void activeTexture(const SceneMaterial& shapeMat);
+    // camera paths, in the format read by the benchmark
+    CameraPath m_recordedPath;
+    std::string m_recordFilePath;
+    bool m_recording = false;
+    float m_recordTime = 0.f;                           // seconds since the last recorded frame
+    constexpr static float recordTimestep = 1.f / 60.f;
+    CameraPath m_replayPath;
+    bool m_replaying = false;
+    int m_replayFrame = 0;
+    CameraPose getCameraPose();
+
+    WidgetContext m_context{this};
+    Renderer m_renderer;
+
+    // rolling timings of m_renderer, shown when settings.performanceOverlay is on
+    QLabel *m_profilerOverlay;
+    QElapsedTimer m_overlayTimer;                       // time since the overlay text was last refreshed
+    constexpr static int overlayRefreshMs = 250;
+    void updateProfilerOverlay();
 };
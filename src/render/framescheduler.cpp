@@ -0,0 +1,108 @@
+#include "framescheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+// longest time step handed to the tick callback, so a late frame does not move the camera far
+const float MAX_DELTA_TIME = 0.1f;
+
+}
+
+FrameScheduler::FrameScheduler(TickCallback tick)
+    : m_tick(std::move(tick))
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&m_timer, &QTimer::timeout, [this]() { onTimeout(); });
+    m_clock.start();
+}
+
+void FrameScheduler::setTargetFrameRate(double framesPerSecond) {
+    m_targetFrameRate = std::max(framesPerSecond, 0.0);
+}
+
+void FrameScheduler::setDisplayRefreshRate(double hertz) {
+    if (hertz > 0.0) {
+        m_displayRefreshRate = hertz;
+    }
+}
+
+void FrameScheduler::setBackgroundFrameRate(double framesPerSecond) {
+    if (framesPerSecond > 0.0) {
+        m_backgroundFrameRate = framesPerSecond;
+    }
+}
+
+void FrameScheduler::setFocused(bool focused) {
+    m_focused = focused;
+}
+
+void FrameScheduler::requestFrame() {
+    m_requested = true;
+    schedule();
+}
+
+void FrameScheduler::setContinuous(bool continuous) {
+    m_continuous = continuous;
+    if (continuous) {
+        schedule();
+    }
+}
+
+void FrameScheduler::stop() {
+    m_timer.stop();
+    m_requested = false;
+    m_continuous = false;
+}
+
+/**
+ * @return the rate frames are currently paced to
+ */
+double FrameScheduler::getFrameRate() const {
+    double rate = m_targetFrameRate > 0.0 ? m_targetFrameRate : m_displayRefreshRate;
+    return m_focused ? rate : std::min(rate, m_backgroundFrameRate);
+}
+
+qint64 FrameScheduler::getFramePeriodNs() const {
+    return qint64(1e9 / getFrameRate());
+}
+
+/**
+ * @brief start the timer for the next tick unless it is already running. A tick is due one
+ *      period after the previous one; after an idle phase it happens right away.
+ */
+void FrameScheduler::schedule() {
+    if (m_timer.isActive()) {
+        return;
+    }
+
+    qint64 now = m_clock.nsecsElapsed();
+    if (m_lastTickNs < 0 || m_nextTickNs < now - getFramePeriodNs()) {
+        // idle (or far behind): restart the schedule from now instead of catching up
+        m_nextTickNs = now;
+    }
+    qint64 delayMs = std::max<qint64>((m_nextTickNs - now) / 1000000, 0);
+    m_timer.start(delayMs);
+}
+
+/**
+ * @brief run the tick callback and, in continuous mode, schedule the following tick on the
+ *      absolute grid m_nextTickNs + k * period.
+ */
+void FrameScheduler::onTimeout() {
+    qint64 now = m_clock.nsecsElapsed();
+    qint64 period = getFramePeriodNs();
+    bool wasIdle = m_lastTickNs < 0 || now - m_lastTickNs > 2 * period;
+    float deltaTime = wasIdle ? period * 1e-9f : (now - m_lastTickNs) * 1e-9f;
+    m_lastTickNs = now;
+    m_nextTickNs += period;
+
+    m_requested = false;
+    m_tick(std::min(deltaTime, MAX_DELTA_TIME));
+
+    // the callback may have requested another frame or turned continuous mode on
+    if (m_requested || m_continuous) {
+        schedule();
+    }
+}
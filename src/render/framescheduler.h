@@ -0,0 +1,57 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <functional>
+#include <QElapsedTimer>
+#include <QTimer>
+
+// Decides when the next frame is produced. Nothing is rendered unless a frame was requested
+// (camera moved, settings or scene changed) or continuous mode is on (keys held, animation).
+// Frames are paced to a target rate on an absolute schedule, so rounding of the period does not
+// accumulate into drift, and the rate is capped further while the window is in the background.
+class FrameScheduler
+{
+public:
+    // receives the seconds since the previous tick (one frame period after an idle phase)
+    using TickCallback = std::function<void(float deltaTime)>;
+
+    explicit FrameScheduler(TickCallback tick);
+
+    // frames per second when active; 0 follows the display refresh rate
+    void setTargetFrameRate(double framesPerSecond);
+    void setDisplayRefreshRate(double hertz);
+    // frames per second while the window does not have focus
+    void setBackgroundFrameRate(double framesPerSecond);
+    void setFocused(bool focused);
+
+    // tick once, as soon as the pacing allows
+    void requestFrame();
+    // tick every frame period while on
+    void setContinuous(bool continuous);
+    // cancel any scheduled tick
+    void stop();
+
+    double getFrameRate() const;
+
+private:
+    void schedule();
+    void onTimeout();
+    qint64 getFramePeriodNs() const;
+
+    TickCallback m_tick;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+
+    double m_targetFrameRate = 0.0;
+    double m_displayRefreshRate = 60.0;
+    double m_backgroundFrameRate = 10.0;
+    bool m_focused = true;
+
+    bool m_requested = false;
+    bool m_continuous = false;
+    // time of the last tick and the time the next one is due, in m_clock nanoseconds
+    qint64 m_lastTickNs = -1;
+    qint64 m_nextTickNs = 0;
+};
+
+#endif // FRAMESCHEDULER_H
@@ -0,0 +1,56 @@
+#include "frustum.h"
+
+/**
+ * @brief Gribb/Hartmann plane extraction. Each plane is row 3 of the matrix plus or minus one of
+ *      rows 0-2, normalized so that plane distances are in world units.
+ * @param viewProj maps world space to clip space
+ */
+Frustum::Frustum(const glm::mat4& viewProj) {
+    glm::mat4 rows = glm::transpose(viewProj);
+    for (int axis = 0; axis < 3; axis++) {
+        m_planes[axis * 2] = rows[3] + rows[axis];
+        m_planes[axis * 2 + 1] = rows[3] - rows[axis];
+    }
+    for (glm::vec4& plane : m_planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+/**
+ * @brief test the box corner furthest along each plane normal; if it is behind any plane, the
+ *      whole box is outside.
+ */
+bool Frustum::intersects(const AABB& box) const {
+    for (const glm::vec4& plane : m_planes) {
+        glm::vec3 furthest(plane.x >= 0.f ? box.max.x : box.min.x,
+                           plane.y >= 0.f ? box.max.y : box.min.y,
+                           plane.z >= 0.f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), furthest) + plane.w < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief a box is inside when its corner nearest to each plane is also in front of that plane.
+ */
+Frustum::Containment Frustum::classify(const AABB& box) const {
+    Containment result = Containment::INSIDE;
+    for (const glm::vec4& plane : m_planes) {
+        glm::vec3 normal(plane);
+        glm::vec3 furthest(plane.x >= 0.f ? box.max.x : box.min.x,
+                           plane.y >= 0.f ? box.max.y : box.min.y,
+                           plane.z >= 0.f ? box.max.z : box.min.z);
+        if (glm::dot(normal, furthest) + plane.w < 0.f) {
+            return Containment::OUTSIDE;
+        }
+        glm::vec3 nearest(plane.x >= 0.f ? box.min.x : box.max.x,
+                          plane.y >= 0.f ? box.min.y : box.max.y,
+                          plane.z >= 0.f ? box.min.z : box.max.z);
+        if (glm::dot(normal, nearest) + plane.w < 0.f) {
+            result = Containment::INTERSECTING;
+        }
+    }
+    return result;
+}
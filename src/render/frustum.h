@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "utils/aabb.h"
+
+// visible / culled counts of one pass
+struct CullStats {
+    int visible = 0;
+    int culled = 0;
+};
+
+// The six clip planes of a view-projection matrix, pointing inwards.
+class Frustum
+{
+public:
+    Frustum() = default;
+    // extracts the planes of the clip volume -w <= x, y, z <= w
+    explicit Frustum(const glm::mat4& viewProj);
+
+    enum class Containment {
+        OUTSIDE,
+        INTERSECTING,
+        INSIDE
+    };
+
+    // conservative: may report boxes near a frustum corner as visible
+    bool intersects(const AABB& box) const;
+    // like intersects(), but also tells whether the box is entirely inside
+    Containment classify(const AABB& box) const;
+
+private:
+    glm::vec4 m_planes[6];
+};
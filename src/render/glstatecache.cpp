@@ -0,0 +1,91 @@
+#include "glstatecache.h"
+
+GLStateCache::GLStateCache() {
+    reset();
+}
+
+void GLStateCache::reset() {
+    m_program = UNKNOWN;
+    m_vao = UNKNOWN;
+    m_activeUnit = -1;
+    m_textures.fill(UNKNOWN);
+    m_material = -1;
+}
+
+/**
+ * @brief count a requested state change.
+ * @return true if the change must be issued to GL
+ */
+bool GLStateCache::changed(bool isDifferent) {
+    if (isDifferent) {
+        m_stats.binds++;
+    } else {
+        m_stats.redundantBinds++;
+    }
+    return isDifferent;
+}
+
+void GLStateCache::useProgram(GLuint program) {
+    if (changed(program != m_program)) {
+        glUseProgram(program);
+        m_program = program;
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+    if (changed(vao != m_vao)) {
+        glBindVertexArray(vao);
+        m_vao = vao;
+    }
+}
+
+/**
+ * @brief bind a texture (2D unless another target is given) to a texture unit, only switching the
+ *      active unit when needed.
+ */
+void GLStateCache::bindTexture(int unit, GLuint texture, GLenum target) {
+    if (unit < 0 || unit >= MAX_TEXTURE_UNITS) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        m_activeUnit = -1;
+        return;
+    }
+
+    if (!changed(texture != m_textures[unit])) {
+        return;
+    }
+    if (unit != m_activeUnit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_activeUnit = unit;
+    }
+    glBindTexture(target, texture);
+    m_textures[unit] = texture;
+}
+
+bool GLStateCache::bindMaterial(int materialId) {
+    bool isDifferent = changed(materialId != m_material);
+    m_material = materialId;
+    return isDifferent;
+}
+
+void GLStateCache::countDraw(int instanceCount, int trianglesPerInstance) {
+    m_stats.drawCalls++;
+    m_stats.instances += instanceCount;
+    m_stats.triangles += instanceCount * trianglesPerInstance;
+}
+
+void GLStateCache::beginFrame() {
+    reset();
+    m_stats = RenderStats();
+}
+
+void GLStateCache::endFrame() {
+    m_lastFrameStats = m_stats;
+}
+
+/**
+ * @return counters of the last complete frame
+ */
+const RenderStats& GLStateCache::getStats() const {
+    return m_lastFrameStats;
+}
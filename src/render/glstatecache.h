@@ -0,0 +1,63 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <array>
+
+struct RenderStats {
+    int drawCalls = 0;
+    int instances = 0;
+    int triangles = 0;
+    // state changes that reached GL
+    int binds = 0;
+    // state changes skipped because the requested state was already current
+    int redundantBinds = 0;
+};
+
+// Tracks the GL bindings made through it and drops the ones that would not change anything.
+// Anything that binds state behind its back (Qt, texture uploads, ...) must be followed by reset().
+class GLStateCache
+{
+public:
+    static constexpr int MAX_TEXTURE_UNITS = 16;
+
+    GLStateCache();
+
+    // forget all tracked state so that the next bind of each kind always reaches GL
+    void reset();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    // a unit is assumed to be used with one target only
+    void bindTexture(int unit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+    // material uniforms are not GL objects; this only tracks which material is current
+    // @return true if the material changed and its uniforms / textures must be set
+    bool bindMaterial(int materialId);
+
+    void countDraw(int instanceCount, int trianglesPerInstance = 0);
+
+    // beginFrame() resets the tracked state and the counters; endFrame() latches the counters,
+    // which getStats() then reports until the next endFrame().
+    void beginFrame();
+    void endFrame();
+    const RenderStats& getStats() const;
+
+private:
+    // never returned by glGen*/glCreateProgram in practice; marks state as unknown
+    static constexpr GLuint UNKNOWN = ~GLuint(0);
+
+    bool changed(bool isDifferent);
+
+    GLuint m_program = UNKNOWN;
+    GLuint m_vao = UNKNOWN;
+    int m_activeUnit = -1;
+    std::array<GLuint, MAX_TEXTURE_UNITS> m_textures;
+    int m_material = -1;
+
+    RenderStats m_stats;
+    RenderStats m_lastFrameStats;
+};
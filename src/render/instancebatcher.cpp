@@ -0,0 +1,424 @@
+#include "instancebatcher.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+namespace {
+
+bool sameFileMap(const SceneFileMap& a, const SceneFileMap& b) {
+    if (a.isUsed != b.isUsed) return false;
+    if (!a.isUsed) return true;
+    return a.filename == b.filename && a.repeatU == b.repeatU && a.repeatV == b.repeatV;
+}
+
+// only the fields that reach the shaders matter for batching
+bool sameMaterial(const SceneMaterial& a, const SceneMaterial& b) {
+    return a.cAmbient == b.cAmbient &&
+           a.cDiffuse == b.cDiffuse &&
+           a.cSpecular == b.cSpecular &&
+           a.shininess == b.shininess &&
+           a.blend == b.blend &&
+           sameFileMap(a.textureMap, b.textureMap) &&
+           sameFileMap(a.normalMap, b.normalMap) &&
+           sameFileMap(a.bumpMap, b.bumpMap);
+}
+
+// the texture, normal and bump map filenames (empty when unused) identify the bound texture set
+std::string textureSetName(const SceneMaterial& m) {
+    auto name = [](const SceneFileMap& map) { return map.isUsed ? map.filename : std::string(); };
+    return name(m.textureMap) + '\n' + name(m.normalMap) + '\n' + name(m.bumpMap);
+}
+
+size_t hashMaterial(const SceneMaterial& m) {
+    std::hash<float> h;
+    size_t seed = 0;
+    auto combine = [&](size_t v) { seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+    for (int i = 0; i < 4; i++) {
+        combine(h(m.cAmbient[i]));
+        combine(h(m.cDiffuse[i]));
+        combine(h(m.cSpecular[i]));
+    }
+    combine(h(m.shininess));
+    combine(std::hash<std::string>()(m.textureMap.isUsed ? m.textureMap.filename : ""));
+    return seed;
+}
+
+}
+
+/**
+ * @brief group shapes by (shape, material), compute per instance transforms and world bounds,
+ *      and create one vao per group and level of detail. Each vao reads vertices from that
+ *      level's vbo (attributes 0-3) and one InstanceData per visible instance from the stream
+ *      vbo (attributes 4-10, divisor 1, re-pointed by bindInstanceAttribs).
+ * @param context is made current for the openGL calls
+ * @param shapes is the flattened scene from SceneParser::parse
+ * @param shapeManager must already hold every mesh referenced by shapes
+ */
+void InstanceBatcher::build(GLContext* context, const std::vector<RenderShapeData>& shapes, ShapeManager& shapeManager) {
+    context->makeCurrent();
+    deleteGroups();
+
+    // shape pointer + material hash -> candidate groups with that key
+    std::unordered_map<const Shape*, std::unordered_multimap<size_t, int>> groupLookup;
+
+    std::unordered_map<const Shape*, int> shapeIds;
+    std::unordered_multimap<size_t, int> materialLookup; // material hash -> group holding the first use
+    std::unordered_map<std::string, int> textureSetIds;
+    int numMaterials = 0;
+
+    for (int shapeIndex = 0; shapeIndex < (int)shapes.size(); shapeIndex++) {
+        const RenderShapeData& shapeData = shapes[shapeIndex];
+        const Shape* shape = &shapeManager.getShape(shapeData);
+        size_t materialHash = hashMaterial(shapeData.primitive.material);
+
+        int groupIndex = -1;
+        auto& candidates = groupLookup[shape];
+        auto range = candidates.equal_range(materialHash);
+        for (auto it = range.first; it != range.second; it++) {
+            if (sameMaterial(m_groups[it->second].material, shapeData.primitive.material)) {
+                groupIndex = it->second;
+                break;
+            }
+        }
+
+        if (groupIndex < 0) {
+            const SceneMaterial& material = shapeData.primitive.material;
+            groupIndex = m_groups.size();
+
+            int materialId = -1;
+            auto materialRange = materialLookup.equal_range(materialHash);
+            for (auto it = materialRange.first; it != materialRange.second; it++) {
+                if (sameMaterial(m_groups[it->second].material, material)) {
+                    materialId = m_groups[it->second].materialId;
+                    break;
+                }
+            }
+            if (materialId < 0) {
+                materialId = numMaterials++;
+                materialLookup.emplace(materialHash, groupIndex);
+            }
+
+            int shapeId = shapeIds.emplace(shape, shapeIds.size()).first->second;
+            int textureSetId = textureSetIds.emplace(textureSetName(material), textureSetIds.size()).first->second;
+
+            InstanceGroup group{shape, {}, {}, material, {}, shapeId, materialId, textureSetId, glm::vec3(0.f)};
+            for (int lod = 0; lod < shapeManager.getLodCount(shapeData); lod++) {
+                group.lods.push_back(&shapeManager.getShape(shapeData, lod));
+            }
+            m_groups.push_back(group);
+            candidates.emplace(materialHash, groupIndex);
+        }
+        m_groups[groupIndex].shapeIndices.push_back(shapeIndex);
+    }
+
+    m_shapeBounds.assign(shapes.size(), AABB());
+    m_shapeInstances.assign(shapes.size(), {-1, -1});
+    m_excludedShapes.assign(shapes.size(), false);
+    m_numExcluded = 0;
+
+    for (int groupIndex = 0; groupIndex < (int)m_groups.size(); groupIndex++) {
+        InstanceGroup& group = m_groups[groupIndex];
+        for (int shapeIndex : group.shapeIndices) {
+            const glm::mat4& ctm = shapes[shapeIndex].ctm;
+            m_shapeInstances[shapeIndex] = {groupIndex, (int)group.instances.size()};
+            group.instances.push_back(InstanceData{ctm, glm::inverse(glm::transpose(glm::mat3(ctm)))});
+            group.instanceBounds.push_back(group.shape->bounds.transformed(ctm));
+            group.center += glm::vec3(ctm[3]);
+            m_shapeBounds[shapeIndex] = group.instanceBounds.back();
+        }
+        group.center /= (float)group.shapeIndices.size();
+        group.instanceLods.assign(group.instances.size(), -1);
+
+        group.lodVaos.resize(group.lods.size());
+        glGenVertexArrays(group.lodVaos.size(), group.lodVaos.data());
+        for (int lod = 0; lod < (int)group.lods.size(); lod++) {
+            glBindVertexArray(group.lodVaos[lod]);
+            group.lods[lod]->bindVertexAttribs();
+            for (int location = 4; location <= 10; location++) {
+                glEnableVertexAttribArray(location);
+                glVertexAttribDivisor(location, 1);
+            }
+        }
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    m_bvh.build(m_shapeBounds);
+    m_bvhDirty = false;
+
+    std::cout << "instancing: " << shapes.size() << " shapes in " << m_groups.size() << " draw groups, "
+              << m_bvh.getNodes().size() << " bvh nodes" << std::endl;
+
+    context->doneCurrent();
+}
+
+/**
+ * @brief delete the vao of every group.
+ * @param context is made current for the openGL calls
+ */
+void InstanceBatcher::finish(GLContext* context) {
+    context->makeCurrent();
+    deleteGroups();
+    context->doneCurrent();
+}
+
+const std::vector<InstanceGroup>& InstanceBatcher::getGroups() const {
+    return m_groups;
+}
+
+void InstanceBatcher::deleteGroups() {
+    for (InstanceGroup& group : m_groups) {
+        glDeleteVertexArrays(group.lodVaos.size(), group.lodVaos.data());
+    }
+    m_groups.clear();
+}
+
+/**
+ * @brief find the instances whose bounds intersect a frustum and remember them per group.
+ * @return number of visible and culled instances
+ */
+CullStats InstanceBatcher::cull(const Frustum& frustum) {
+    refitIfDirty();
+    m_queryResult.clear();
+    m_bvh.queryFrustum(frustum, m_queryResult);
+    return collectVisible();
+}
+
+CullStats InstanceBatcher::cull(const std::vector<Frustum>& frusta) {
+    refitIfDirty();
+    m_queryResult.clear();
+    for (const Frustum& frustum : frusta) {
+        m_bvh.queryFrustum(frustum, m_queryResult);
+    }
+    // a shape inside several frusta is reported once per frustum
+    std::sort(m_queryResult.begin(), m_queryResult.end());
+    m_queryResult.erase(std::unique(m_queryResult.begin(), m_queryResult.end()), m_queryResult.end());
+    return collectVisible();
+}
+
+CullStats InstanceBatcher::collectVisible() {
+    for (InstanceGroup& group : m_groups) {
+        group.visible.clear();
+        group.visibleLods.clear();
+    }
+
+    CullStats stats;
+    for (int shapeIndex : m_queryResult) {
+        if (m_excludedShapes[shapeIndex]) continue;
+        auto [groupIndex, instance] = m_shapeInstances[shapeIndex];
+        m_groups[groupIndex].visible.push_back(instance);
+        stats.visible++;
+    }
+
+    stats.culled = m_shapeBounds.size() - m_numExcluded - stats.visible;
+    return stats;
+}
+
+void InstanceBatcher::setExcludedShapes(const std::vector<int>& shapeIndices) {
+    m_excludedShapes.assign(m_shapeBounds.size(), false);
+    for (int shapeIndex : shapeIndices) {
+        m_excludedShapes[shapeIndex] = true;
+    }
+    m_numExcluded = shapeIndices.size();
+}
+
+/**
+ * @brief drop visible instances after the frustum cull, e.g. the ones known to be occluded.
+ */
+void InstanceBatcher::filterVisible(const std::function<bool(int shapeIndex)>& keep) {
+    for (InstanceGroup& group : m_groups) {
+        auto hidden = [&](int instance) { return !keep(group.shapeIndices[instance]); };
+        group.visible.erase(std::remove_if(group.visible.begin(), group.visible.end(), hidden), group.visible.end());
+        group.visibleLods.clear();
+    }
+}
+
+void InstanceBatcher::selectVisible(const std::vector<int>& shapeIndices, const LodView& view) {
+    for (InstanceGroup& group : m_groups) {
+        group.visible.clear();
+        group.visibleLods.clear();
+    }
+    for (int shapeIndex : shapeIndices) {
+        auto [groupIndex, instance] = m_shapeInstances[shapeIndex];
+        m_groups[groupIndex].visible.push_back(instance);
+    }
+    // levels of shapes that skipped the camera pass are stale, so choose them like it does
+    selectLods(view, true);
+}
+
+/**
+ * @brief pick a level of detail for each visible instance from its projected bounds.
+ * @param view describes the projection of the pass
+ * @param hysteresis makes levels depend on (and update) each instance's previous level
+ */
+void InstanceBatcher::selectLods(const LodView& view, bool hysteresis) {
+    for (InstanceGroup& group : m_groups) {
+        int numLods = group.lods.size();
+        group.visibleLods.resize(group.visible.size());
+        for (int k = 0; k < (int)group.visible.size(); k++) {
+            int instance = group.visible[k];
+            float screenSize = view.screenSize(group.instanceBounds[instance]);
+            int lod = LodView::selectLevel(screenSize, numLods, hysteresis ? group.instanceLods[instance] : -1);
+            if (hysteresis) {
+                group.instanceLods[instance] = lod;
+            }
+            group.visibleLods[k] = lod;
+        }
+    }
+}
+
+/**
+ * @brief pick one level of detail per visible instance for a pass that renders several views:
+ *      the level of the view in which the instance is largest.
+ */
+void InstanceBatcher::selectLods(const std::vector<LodView>& views) {
+    for (InstanceGroup& group : m_groups) {
+        int numLods = group.lods.size();
+        group.visibleLods.resize(group.visible.size());
+        for (int k = 0; k < (int)group.visible.size(); k++) {
+            const AABB& bounds = group.instanceBounds[group.visible[k]];
+            float screenSize = 0.f;
+            for (const LodView& view : views) {
+                screenSize = std::max(screenSize, view.screenSize(bounds));
+            }
+            group.visibleLods[k] = LodView::selectLevel(screenSize, numLods);
+        }
+    }
+}
+
+/**
+ * @brief gather the visible instances of all groups into one contiguous write to the stream.
+ *      Every pass gets its own range of the frame's region, so nothing the GPU still reads for an
+ *      earlier pass or frame is overwritten and no implicit synchronization is needed.
+ */
+void InstanceBatcher::uploadVisible(StreamBuffer& stream) {
+    m_staging.clear();
+    for (InstanceGroup& group : m_groups) {
+        if (group.visibleLods.size() != group.visible.size()) {
+            group.visibleLods.assign(group.visible.size(), 0);
+        }
+        sortVisibleByLod(group);
+
+        group.streamOffset = m_staging.size() * sizeof(InstanceData);
+        for (int instance : group.visible) {
+            m_staging.push_back(group.instances[instance]);
+        }
+    }
+
+    GLintptr base = stream.write(m_staging.data(), m_staging.size() * sizeof(InstanceData), sizeof(InstanceData));
+    m_streamVbo = stream.getBuffer();
+    for (InstanceGroup& group : m_groups) {
+        group.streamOffset += base;
+    }
+}
+
+void InstanceBatcher::bindInstanceAttribs(const InstanceGroup& group, int firstVisible) const {
+    GLintptr streamOffset = group.streamOffset + firstVisible * sizeof(InstanceData);
+    glBindBuffer(GL_ARRAY_BUFFER, m_streamVbo);
+    // model matrix, one vec4 column per location
+    for (int column = 0; column < 4; column++) {
+        size_t offset = streamOffset + offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec4);
+        glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(offset));
+    }
+    // normal matrix, one vec3 column per location
+    for (int column = 0; column < 3; column++) {
+        size_t offset = streamOffset + offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec3);
+        glVertexAttribPointer(8 + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(offset));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief stable counting sort of the visible instances by level of detail, so that each level
+ *      is one contiguous range of the stream.
+ */
+void InstanceBatcher::sortVisibleByLod(InstanceGroup& group) {
+    int numLods = group.lods.size();
+    int counts[LodView::MAX_LEVELS + 1] = {};
+    bool sorted = true;
+    for (int k = 0; k < (int)group.visibleLods.size(); k++) {
+        counts[group.visibleLods[k] + 1]++;
+        sorted &= k == 0 || group.visibleLods[k - 1] <= group.visibleLods[k];
+    }
+    if (sorted) return;
+
+    for (int lod = 0; lod < numLods; lod++) {
+        counts[lod + 1] += counts[lod];
+    }
+    m_sortScratch.resize(group.visible.size());
+    for (int k = 0; k < (int)group.visible.size(); k++) {
+        m_sortScratch[counts[group.visibleLods[k]]++] = group.visible[k];
+    }
+    group.visible.swap(m_sortScratch);
+    std::sort(group.visibleLods.begin(), group.visibleLods.end());
+}
+
+/**
+ * @brief call back once per run of equal level of detail in visible[firstVisible, firstVisible + count).
+ *      Requires the order established by uploadVisible().
+ */
+void InstanceBatcher::forEachLodRun(const InstanceGroup& group, int firstVisible, int count, const LodRunCallback& callback) const {
+    int end = firstVisible + count;
+    for (int runBegin = firstVisible; runBegin < end;) {
+        int lod = group.visibleLods[runBegin];
+        int runEnd = runBegin + 1;
+        while (runEnd < end && group.visibleLods[runEnd] == lod) {
+            runEnd++;
+        }
+        callback(*group.lods[lod], group.lodVaos[lod], runBegin, runEnd - runBegin);
+        runBegin = runEnd;
+    }
+}
+
+/**
+ * @brief replace the transform of one shape, e.g. for animation. Only its instance data and
+ *      bounds are updated; the bvh is refit (not rebuilt) lazily.
+ * @param shapeIndex is the index in RenderData::shapes
+ * @param ctm is the new cumulative transformation matrix
+ */
+void InstanceBatcher::updateTransform(int shapeIndex, const glm::mat4& ctm) {
+    auto [groupIndex, instance] = m_shapeInstances[shapeIndex];
+    InstanceGroup& group = m_groups[groupIndex];
+
+    group.instances[instance] = InstanceData{ctm, glm::inverse(glm::transpose(glm::mat3(ctm)))};
+    group.instanceBounds[instance] = group.shape->bounds.transformed(ctm);
+    m_shapeBounds[shapeIndex] = group.instanceBounds[instance];
+    m_bvhDirty = true;
+}
+
+void InstanceBatcher::refitIfDirty() {
+    if (m_bvhDirty) {
+        m_bvh.refit(m_shapeBounds);
+        m_bvhDirty = false;
+    }
+}
+
+/**
+ * @brief find the nearest shape along a world-space ray. Candidates come from the bvh; each is
+ *      tested exactly by moving the ray into the shape's object space.
+ * @param tHit receives the distance along the ray in units of direction's length
+ * @return index in RenderData::shapes, or -1
+ */
+int InstanceBatcher::raycast(const glm::vec3& origin, const glm::vec3& direction, float& tHit) {
+    refitIfDirty();
+
+    return m_bvh.raycast(origin, direction, tHit, [&](int shapeIndex, float& t) {
+        auto [groupIndex, instance] = m_shapeInstances[shapeIndex];
+        const InstanceGroup& group = m_groups[groupIndex];
+        glm::mat4 worldToObject = glm::inverse(group.instances[instance].modelMatrix);
+        glm::vec3 objectOrigin = glm::vec3(worldToObject * glm::vec4(origin, 1.f));
+        glm::vec3 objectDirection = glm::vec3(worldToObject * glm::vec4(direction, 0.f));
+        return intersectRayShape(*group.shape, objectOrigin, objectDirection, t);
+    });
+}
+
+const BVH& InstanceBatcher::getBVH() const {
+    return m_bvh;
+}
+
+const std::vector<AABB>& InstanceBatcher::getShapeBounds() const {
+    return m_shapeBounds;
+}
@@ -0,0 +1,125 @@
+#ifndef INSTANCEBATCHER_H
+#define INSTANCEBATCHER_H
+
+#include <functional>
+
+#include "render/frustum.h"
+#include "render/lodview.h"
+#include "shapes/shapemanager.h"
+#include "utils/aabb.h"
+#include "utils/bvh.h"
+#include "utils/sceneparser.h"
+#include "utils/streambuffer.h"
+
+// Per-instance vertex attributes (locations 4-7: model matrix, 8-10: normal matrix)
+struct InstanceData {
+    glm::mat4 modelMatrix;
+    glm::mat3 normalMatrix;
+};
+
+// All shapes in the scene that share a primitive type / meshfile and a material.
+// Their visible instances are drawn together with one glDrawElementsInstanced call per pass.
+struct InstanceGroup {
+    // finest level of detail; its bounds are used for culling and picking
+    const Shape* shape;
+    // every level of detail, finest first, and the vao combining each with the instance stream
+    std::vector<const Shape*> lods;
+    std::vector<GLuint> lodVaos;
+    SceneMaterial material;
+    // indices into RenderData::shapes, in instance order
+    std::vector<int> shapeIndices;
+
+    // dense ids used to build render queue sort keys. Groups with equal ids share that state.
+    int shapeId;
+    int materialId;
+    int textureSetId;
+    // average world-space position of the instances, for depth sorting
+    glm::vec3 center;
+
+    // per instance transforms and world-space bounds, parallel to shapeIndices
+    std::vector<InstanceData> instances;
+    std::vector<AABB> instanceBounds;
+    // level of detail each instance used in the last camera pass, for hysteresis (-1: none yet)
+    std::vector<int> instanceLods;
+
+    // result of the last cull: indices into instances, and where uploadVisible put them in the
+    // stream buffer. uploadVisible orders them by level of detail (visibleLods, parallel to visible).
+    std::vector<int> visible;
+    std::vector<int> visibleLods;
+    GLintptr streamOffset;
+};
+
+class InstanceBatcher
+{
+public:
+    // group the flattened scene and upload the per-instance transforms. Call after the meshes are parsed.
+    void build(GLContext* context, const std::vector<RenderShapeData>& shapes, ShapeManager& shapeManager);
+    void finish(GLContext* context);
+
+    const std::vector<InstanceGroup>& getGroups() const;
+
+    // Per pass: cull() selects the instances whose world bounds intersect the frustum (using the
+    // bvh over all shapes) and uploadVisible() writes their transforms to the frame's stream
+    // region. Groups without visible instances must be skipped.
+    CullStats cull(const Frustum& frustum);
+    // instances intersecting any of the frusta, for passes rendering several views at once
+    CullStats cull(const std::vector<Frustum>& frusta);
+    // shapes (indices in RenderData::shapes) that cull() never reports, e.g. because they are drawn
+    // by the StaticBatcher. They still take part in raycast().
+    void setExcludedShapes(const std::vector<int>& shapeIndices);
+    // keep only the visible instances whose shape (index in RenderData::shapes) passes the test
+    void filterVisible(const std::function<bool(int shapeIndex)>& keep);
+    // make exactly the given shapes visible, replacing the result of the last cull, and choose
+    // their levels of detail in the camera view (with hysteresis, as selectLods does for it)
+    void selectVisible(const std::vector<int>& shapeIndices, const LodView& view);
+    // Choose the level of detail of every visible instance from its projected size. With
+    // hysteresis the levels are also remembered for the next call (use it for the camera pass).
+    // Instances get level 0 if this is not called before uploadVisible().
+    void selectLods(const LodView& view, bool hysteresis);
+    // the finest level any of the views needs, without hysteresis
+    void selectLods(const std::vector<LodView>& views);
+    void uploadVisible(StreamBuffer& stream);
+    // point attributes 4-10 of the bound group vao at the group's visible instances, starting
+    // with visible[firstVisible]
+    void bindInstanceAttribs(const InstanceGroup& group, int firstVisible = 0) const;
+    // split visible[firstVisible, firstVisible + count) of an uploaded group into runs that share a
+    // level of detail, e.g. to issue one instanced draw per run
+    using LodRunCallback = std::function<void(const Shape& shape, GLuint vao, int firstVisible, int count)>;
+    void forEachLodRun(const InstanceGroup& group, int firstVisible, int count, const LodRunCallback& callback) const;
+
+    // move one shape; the bvh is refit before the next cull or raycast
+    void updateTransform(int shapeIndex, const glm::mat4& ctm);
+
+    // nearest shape hit by a world-space ray (exact triangle test), or -1. Used for mouse picking.
+    int raycast(const glm::vec3& origin, const glm::vec3& direction, float& tHit);
+
+    const BVH& getBVH() const;
+    // world bounds of every shape, indexed like RenderData::shapes
+    const std::vector<AABB>& getShapeBounds() const;
+
+private:
+    void deleteGroups();
+    void refitIfDirty();
+    // fill the groups' visible lists from m_queryResult
+    CullStats collectVisible();
+    void sortVisibleByLod(InstanceGroup& group);
+
+    // world bounds of every shape, indexed like RenderData::shapes, and the hierarchy over them
+    std::vector<AABB> m_shapeBounds;
+    BVH m_bvh;
+    bool m_bvhDirty = false;
+    // (group, instance) of every shape
+    std::vector<std::pair<int, int>> m_shapeInstances;
+    std::vector<bool> m_excludedShapes;
+    int m_numExcluded = 0;
+    std::vector<int> m_queryResult;
+
+    std::vector<InstanceGroup> m_groups;
+
+    // buffer holding the instances of the last uploadVisible()
+    GLuint m_streamVbo = 0;
+    std::vector<InstanceData> m_staging;
+    std::vector<int> m_sortScratch;
+};
+
+#endif // INSTANCEBATCHER_H
@@ -0,0 +1,55 @@
+#include "lodview.h"
+
+#include <algorithm>
+
+namespace {
+
+// projected diameter in pixels from which level i is used, for levels 0 .. MAX_LEVELS - 2.
+// Anything smaller than the last entry uses the coarsest level.
+const float LEVEL_SIZES[LodView::MAX_LEVELS - 1] = {192.f, 64.f, 20.f};
+
+// a size must be this factor past a threshold before the level changes
+const float HYSTERESIS = 1.2f;
+
+int levelForSize(float screenSize, int numLevels) {
+    int level = 0;
+    while (level < numLevels - 1 && screenSize < LEVEL_SIZES[level]) {
+        level++;
+    }
+    return level;
+}
+
+}
+
+/**
+ * @brief a projection maps y to clip space with a scale of projection[1][1] (divided by the view
+ *      depth for perspective projections), and clip space spans the viewport height twice.
+ */
+LodView::LodView(const glm::mat4& projection, const glm::vec3& eye, float viewportHeight, float bias)
+    : m_eye(eye),
+      m_pixelsPerUnit(projection[1][1] * viewportHeight * 0.5f * bias),
+      m_perspective(projection[3][3] == 0.f)
+{
+}
+
+float LodView::screenSize(const AABB& bounds) const {
+    float diameter = glm::length(bounds.extent());
+    if (!m_perspective) {
+        return diameter * m_pixelsPerUnit;
+    }
+    float distance = std::max(glm::distance(bounds.center(), m_eye), 1e-3f);
+    return diameter * m_pixelsPerUnit / distance;
+}
+
+/**
+ * @brief with hysteresis the new level is the previous one clamped to the range of levels the
+ *      size would select if it were HYSTERESIS times larger or smaller.
+ */
+int LodView::selectLevel(float screenSize, int numLevels, int previousLevel) {
+    if (previousLevel < 0) {
+        return levelForSize(screenSize, numLevels);
+    }
+    int finest = levelForSize(screenSize * HYSTERESIS, numLevels);
+    int coarsest = levelForSize(screenSize / HYSTERESIS, numLevels);
+    return std::clamp(previousLevel, finest, coarsest);
+}
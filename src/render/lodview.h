@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "utils/aabb.h"
+
+// Screen-size driven level of detail for one render pass. Level 0 is the finest; a shape uses the
+// finest level whose size threshold its projected size reaches.
+class LodView
+{
+public:
+    static constexpr int MAX_LEVELS = 4;
+
+    LodView() = default;
+    // @param projection is the pass's projection matrix (perspective or orthographic)
+    // @param eye is the world-space position the pass is rendered from
+    // @param viewportHeight is the height of the render target in pixels
+    // @param bias scales every projected size: above 1 picks finer levels, below 1 coarser ones
+    LodView(const glm::mat4& projection, const glm::vec3& eye, float viewportHeight, float bias);
+
+    // projected diameter of the bounds in pixels, times the bias
+    float screenSize(const AABB& bounds) const;
+
+    // Level for a projected size, clamped to numLevels. Pass the level used last frame as
+    // previousLevel to get hysteresis: the level only changes once the size is clearly past a
+    // threshold, so shapes sitting at a threshold do not flicker between levels.
+    static int selectLevel(float screenSize, int numLevels, int previousLevel = -1);
+
+private:
+    glm::vec3 m_eye = glm::vec3(0.f);
+    // pixels per world unit at distance 1 (perspective) or anywhere (orthographic)
+    float m_pixelsPerUnit = 1.f;
+    bool m_perspective = true;
+};
@@ -0,0 +1,196 @@
+#include "occlusionculler.h"
+
+#include <algorithm>
+
+#include "utils/shaderloader.h"
+#include "utils/uniformblocks.h"
+
+namespace {
+
+// unit cube corners, scaled to a box by occlusion.vert
+const GLfloat CUBE_CORNERS[] = {
+    0.f, 0.f, 0.f,  1.f, 0.f, 0.f,  1.f, 1.f, 0.f,  0.f, 1.f, 0.f,
+    0.f, 0.f, 1.f,  1.f, 0.f, 1.f,  1.f, 1.f, 1.f,  0.f, 1.f, 1.f,
+};
+
+const GLubyte CUBE_INDICES[] = {
+    0, 2, 1,  0, 3, 2, // -z
+    4, 5, 6,  4, 6, 7, // +z
+    0, 1, 5,  0, 5, 4, // -y
+    3, 6, 2,  3, 7, 6, // +y
+    0, 4, 7,  0, 7, 3, // -x
+    1, 2, 6,  1, 6, 5, // +x
+};
+
+bool containsPoint(const AABB& box, const glm::vec3& point) {
+    return glm::all(glm::greaterThanEqual(point, box.min)) && glm::all(glm::lessThanEqual(point, box.max));
+}
+
+}
+
+/**
+ * @brief create the bounding box program and the unit cube it draws.
+ */
+void OcclusionCuller::init() {
+    m_boxProgram.init(ShaderLoader::createShaderProgram(
+        ":/resources/shaders/occlusion.vert",
+        ":/resources/shaders/occlusion.frag"));
+    m_boxProgram.bindUniformBlock("FrameData", UniformBlocks::FRAME_BINDING);
+    m_boxMinLocation = m_boxProgram.getUniformLocation("boxMin");
+    m_boxMaxLocation = m_boxProgram.getUniformLocation("boxMax");
+
+    glGenVertexArrays(1, &m_boxVao);
+    glGenBuffers(1, &m_boxVbo);
+    glGenBuffers(1, &m_boxEbo);
+
+    glBindVertexArray(m_boxVao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_boxVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_CORNERS), CUBE_CORNERS, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_boxEbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(CUBE_INDICES), CUBE_INDICES, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), nullptr);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief delete every query object, the box program and the cube buffers.
+ */
+void OcclusionCuller::finish() {
+    reset(0);
+    m_boxProgram.finish();
+    glDeleteVertexArrays(1, &m_boxVao);
+    glDeleteBuffers(1, &m_boxVbo);
+    glDeleteBuffers(1, &m_boxEbo);
+    m_boxVao = m_boxVbo = m_boxEbo = 0;
+}
+
+/**
+ * @brief drop all queries (pending results are discarded) and mark every shape visible.
+ * @param shapeCount is the size of RenderData::shapes
+ */
+void OcclusionCuller::reset(int shapeCount) {
+    for (ShapeState& state : m_shapes) {
+        if (state.query != 0) {
+            glDeleteQueries(1, &state.query);
+        }
+    }
+    m_shapes.assign(shapeCount, ShapeState());
+    m_pending.clear();
+}
+
+/**
+ * @brief advance the frame counter and apply every query result that the GPU has already
+ *      produced. Results that are not available yet are left for a later frame.
+ */
+void OcclusionCuller::beginFrame() {
+    m_frame++;
+
+    auto stillPending = [&](int shapeIndex) {
+        ShapeState& state = m_shapes[shapeIndex];
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return true;
+        }
+
+        GLuint anySamplesPassed = GL_TRUE;
+        glGetQueryObjectuiv(state.query, GL_QUERY_RESULT, &anySamplesPassed);
+        state.occluded = anySamplesPassed == GL_FALSE;
+        state.pending = false;
+        return false;
+    };
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), stillPending), m_pending.end());
+}
+
+bool OcclusionCuller::isOccluded(int shapeIndex) const {
+    const ShapeState& state = m_shapes[shapeIndex];
+    return state.occluded;
+}
+
+bool OcclusionCuller::needsRetest(int shapeIndex) const {
+    // the offset spreads the re-tests of neighbouring shapes over different frames
+    return !m_shapes[shapeIndex].pending && (m_frame + shapeIndex) % RETEST_INTERVAL == 0;
+}
+
+/**
+ * @brief query the bounding box of each shape against the current depth buffer.
+ *      Boxes are padded so that the shape's own surfaces, when already drawn, do not hide them.
+ * @param shapeBounds are the world bounds of every shape, indexed like RenderData::shapes
+ * @param nearPlane is the camera's near plane distance. Boxes the near plane may clip would be
+ *      reported hidden, so shapes that close to the camera are simply treated as visible.
+ */
+int OcclusionCuller::issueQueries(const std::vector<int>& shapeIndices, const std::vector<AABB>& shapeBounds,
+                                  const glm::vec3& cameraPos, float nearPlane, GLStateCache& stateCache) {
+    if (shapeIndices.empty()) {
+        return 0;
+    }
+
+    stateCache.useProgram(m_boxProgram.getID());
+    stateCache.bindVertexArray(m_boxVao);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);
+    glDisable(GL_CULL_FACE);
+
+    int numQueries = 0;
+    for (int shapeIndex : shapeIndices) {
+        ShapeState& state = m_shapes[shapeIndex];
+
+        AABB box = shapeBounds[shapeIndex];
+        glm::vec3 padding = glm::max(box.extent() * 0.01f, glm::vec3(1e-3f));
+        box.min -= padding;
+        box.max += padding;
+
+        AABB nearBox = box;
+        nearBox.min -= glm::vec3(2.f * nearPlane);
+        nearBox.max += glm::vec3(2.f * nearPlane);
+        if (containsPoint(nearBox, cameraPos)) {
+            state.occluded = false;
+            state.queryFrame = -1;
+            continue;
+        }
+
+        if (state.query == 0) {
+            glGenQueries(1, &state.query);
+        }
+        if (!state.pending) {
+            state.pending = true;
+            m_pending.push_back(shapeIndex);
+        }
+        state.queryFrame = m_frame;
+
+        m_boxProgram.setUniform(m_boxMinLocation, box.min);
+        m_boxProgram.setUniform(m_boxMaxLocation, box.max);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, state.query);
+        glDrawElements(GL_TRIANGLES, sizeof(CUBE_INDICES), GL_UNSIGNED_BYTE, nullptr);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        stateCache.countDraw(1);
+        numQueries++;
+    }
+
+    glEnable(GL_CULL_FACE);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    return numQueries;
+}
+
+/**
+ * @brief start conditional rendering on the shape's query of this frame. GL_QUERY_WAIT makes the
+ *      GPU (not the CPU) wait for the query result.
+ */
+bool OcclusionCuller::beginConditionalRender(int shapeIndex) const {
+    const ShapeState& state = m_shapes[shapeIndex];
+    if (state.queryFrame != m_frame) {
+        return false;
+    }
+    glBeginConditionalRender(state.query, GL_QUERY_WAIT);
+    return true;
+}
+
+void OcclusionCuller::endConditionalRender() const {
+    glEndConditionalRender();
+}
@@ -0,0 +1,77 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "render/glstatecache.h"
+#include "utils/aabb.h"
+#include "utils/shaderprogram.h"
+
+// Hardware occlusion culling with temporal coherence, in the spirit of CHC++.
+// Every shape keeps the visibility its last GL_ANY_SAMPLES_PASSED query reported. Results are only
+// read once available, so the CPU never waits for the GPU:
+//  - shapes visible last time are drawn normally and re-queried every few frames (staggered),
+//  - shapes hidden last time are queried every frame and drawn under conditional rendering, so a
+//    shape that comes into view appears in the same frame instead of popping in a frame late.
+class OcclusionCuller
+{
+public:
+    void init();
+    void finish();
+
+    // forget all visibility, e.g. after a scene load. Every shape starts out visible.
+    void reset(int shapeCount);
+
+    // read back every query result that is already available (never blocks)
+    void beginFrame();
+
+    // true if the last completed query of the shape found it hidden. A re-query still in flight
+    // keeps that answer; only a completed result changes it.
+    bool isOccluded(int shapeIndex) const;
+    // true if a shape drawn in the main pass should be queried again this frame
+    bool needsRetest(int shapeIndex) const;
+
+    // Draw the slightly enlarged world bounds of each shape inside an occlusion query, against the
+    // depth buffer of the main pass. Color and depth writes are off meanwhile. Shapes whose bounds
+    // come within reach of the near plane are marked visible without a query.
+    // @return number of queries issued
+    int issueQueries(const std::vector<int>& shapeIndices, const std::vector<AABB>& shapeBounds,
+                     const glm::vec3& cameraPos, float nearPlane, GLStateCache& stateCache);
+
+    // Draws between these two calls are discarded by the GPU if the shape's query of this frame
+    // found no samples. @return false (and does nothing) if the shape has no query this frame.
+    bool beginConditionalRender(int shapeIndex) const;
+    void endConditionalRender() const;
+
+private:
+    struct ShapeState {
+        GLuint query = 0;
+        bool occluded = false;
+        bool pending = false;
+        int queryFrame = -1;
+    };
+
+    // visible shapes are re-queried once every this many frames
+    static constexpr int RETEST_INTERVAL = 8;
+
+    std::vector<ShapeState> m_shapes;
+    // shapes whose query result has not been read yet
+    std::vector<int> m_pending;
+    int m_frame = 0;
+
+    ShaderProgram m_boxProgram;
+    GLint m_boxMinLocation = -1;
+    GLint m_boxMaxLocation = -1;
+    GLuint m_boxVao = 0;
+    GLuint m_boxVbo = 0;
+    GLuint m_boxEbo = 0;
+};
+
+#endif // OCCLUSIONCULLER_H
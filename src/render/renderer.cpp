@@ -0,0 +1,1123 @@
+#include "renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include "settings.h"
+#include "vertexcreator.h"
+#include "utils/shaderloader.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/norm.hpp>
+
+Renderer::Renderer() {
+    m_biasMatrix = glm::mat4{
+        0.5, 0.0, 0.0, 0.0,
+        0.0, 0.5, 0.0, 0.0,
+        0.0, 0.0, 0.5, 0.0,
+        0.5, 0.5, 0.5, 1.0
+    };
+}
+
+void Renderer::init(GLContext* context) {
+    m_context = context;
+
+    // Initializing GL.
+    // GLEW (GL Extension Wrangler) provides access to OpenGL functions.
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    if (err != GLEW_OK) {
+        std::cerr << "Error while initializing GL: " << glewGetErrorString(err) << std::endl;
+    }
+    std::cout << "Initialized GL: Version " << glewGetString(GLEW_VERSION) << std::endl;
+
+    // Allows OpenGL to draw objects appropriately on top of one another
+    glEnable(GL_DEPTH_TEST);
+    // Tells OpenGL to only draw the front face
+    glEnable(GL_CULL_FACE);
+
+    m_defaultProgram.init(ShaderLoader::createShaderProgram(
+        ":/resources/shaders/default.vert",
+        ":/resources/shaders/default.frag"));
+    m_shadowmapProgram.init(ShaderLoader::createShaderProgram(
+        ":/resources/shaders/shadowmap.vert",
+        ":/resources/shaders/shadowmap.geom",
+        ":/resources/shaders/shadowmap.frag"
+    ));
+    cacheUniformLocations();
+    m_occlusionCuller.init();
+
+    m_streamBuffer.init(streamRegionSize);
+    m_frameUBO.init(UniformBlocks::FRAME_BINDING, sizeof(UniformBlocks::FrameBlock), m_streamBuffer);
+    m_lightsUBO.init(UniformBlocks::LIGHTS_BINDING, sizeof(UniformBlocks::LightsBlock), m_streamBuffer);
+    m_shadowUBO.init(UniformBlocks::SHADOW_BINDING, sizeof(UniformBlocks::ShadowBlock), m_streamBuffer);
+
+    GLint maxTextureSize;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    m_shadowAtlasMax = std::min(m_shadowAtlasMax, (int)maxTextureSize);
+    makeFBO();
+
+    m_shapeManager.init(m_context);
+    m_profiler.init();
+}
+
+void Renderer::finish() {
+    m_context->makeCurrent();
+
+    m_defaultProgram.finish();
+    m_shadowmapProgram.finish();
+
+    m_frameUBO.finish();
+    m_lightsUBO.finish();
+    m_shadowUBO.finish();
+    m_streamBuffer.finish();
+    m_profiler.finish();
+
+    glDeleteTextures(1, &m_shadowAtlasTexture);
+    glDeleteFramebuffers(1, &m_shadowFBO);
+
+    m_occlusionCuller.finish();
+    m_staticBatcher.finish(m_context);
+    m_instanceBatcher.finish(m_context);
+    m_shapeManager.finish(m_context);
+
+    m_context->doneCurrent();
+}
+
+void Renderer::loadScene() {
+    parseScene();
+    createTextureAndNormal();
+}
+
+void Renderer::parseScene() {
+    Profiler::CpuScope scope(m_profiler, "parse scene");
+    if (!m_sceneParser.parse(settings.sceneFilePath, m_renderData)) {
+        std::cerr << "error parsing scene" << std::endl;
+    } else {
+        std::cout << "scene parsed successfully with " << m_renderData.shapes.size() << " shape" << std::endl;
+    }
+
+    m_camera.updateCamData(m_renderData.cameraData);
+    m_shapeManager.parseMeshes(m_context, m_renderData.shapes);
+    m_instanceBatcher.build(m_context, m_renderData.shapes, m_shapeManager);
+    buildStaticBatches();
+    prevStaticBatching = settings.staticBatching;
+    m_sceneBounds = AABB();
+    for (const AABB& bounds : m_instanceBatcher.getShapeBounds()) {
+        m_sceneBounds.expand(bounds);
+    }
+    m_context->makeCurrent();
+    m_occlusionCuller.reset(m_renderData.shapes.size());
+    m_context->doneCurrent();
+    m_logRenderStats = true;
+
+    m_lightsDirty = true;
+
+    m_sceneLoaded = true;
+}
+
+/**
+ * @brief Update the camera projection matrix if the near,far planes have changed in settings.
+ * The shape parameters are read every frame as the level of detail bias (see getLodBias); since
+ * the bias picks the casters' levels of detail, changing it invalidates the shadow maps.
+ * Static batches are built or dropped when static batching is toggled.
+ */
+void Renderer::settingsChanged() {
+    // update camera planes and recompute projection matrix if planes have changed
+    if (settings.nearPlane != prevNearPlane || settings.farPlane != prevFarPlane) {
+        m_camera.updatePlanes(settings.nearPlane, settings.farPlane);
+        prevNearPlane = settings.nearPlane;
+        prevFarPlane = settings.farPlane;
+    }
+
+    if (settings.staticBatching != prevStaticBatching && m_sceneLoaded) {
+        buildStaticBatches();
+        prevStaticBatching = settings.staticBatching;
+        m_logRenderStats = true;
+        invalidateShadowMaps();
+    }
+
+    if (getLodBias() != prevLodBias) {
+        prevLodBias = getLodBias();
+        invalidateShadowMaps();
+    }
+
+    // directional lights get a layer per cascade
+    if (settings.shadowCascades != prevShadowCascades) {
+        prevShadowCascades = settings.shadowCascades;
+        m_lightsDirty = true;
+    }
+}
+
+void Renderer::resize(int width, int height) {
+    m_viewportWidth = std::max(width, 1);
+    m_viewportHeight = std::max(height, 1);
+    // Tells OpenGL how big the screen is
+    glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+
+    m_camera.init(m_renderData.cameraData, m_viewportWidth, m_viewportHeight);
+}
+
+bool Renderer::isSceneLoaded() const {
+    return m_sceneLoaded;
+}
+
+bool Renderer::hasPendingUpdates() const {
+    if (!m_sceneLoaded || !settings.extraCredit1) {
+        return false;
+    }
+    return countDirtyShadowMaps() > 0;
+}
+
+Camera& Renderer::getCamera() {
+    return m_camera;
+}
+
+Profiler& Renderer::getProfiler() {
+    return m_profiler;
+}
+
+/**
+ * @brief cast a ray from the camera through a point and report the nearest shape it hits.
+ * @param ndc is the point in normalized device coordinates (origin at the center, y up)
+ */
+int Renderer::pickShape(glm::vec2 ndc) {
+    if (!m_sceneLoaded) {
+        return -1;
+    }
+
+    glm::mat4 clipToWorld = glm::inverse(m_camera.getProjMatrix() * m_camera.getViewMatrix());
+    glm::vec4 nearPoint = clipToWorld * glm::vec4(ndc, -1.f, 1.f);
+    glm::vec4 farPoint = clipToWorld * glm::vec4(ndc, 1.f, 1.f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+    float distance;
+    int shapeIndex = m_instanceBatcher.raycast(origin, direction, distance);
+    if (shapeIndex >= 0) {
+        const RenderShapeData& shapeData = m_renderData.shapes[shapeIndex];
+        glm::vec3 hitPoint = origin + direction * distance;
+        std::cout << "picked shape " << shapeIndex << " (primitive type " << static_cast<int>(shapeData.primitive.type)
+                  << ") at (" << hitPoint.x << ", " << hitPoint.y << ", " << hitPoint.z << ")" << std::endl;
+    }
+    return shapeIndex;
+}
+
+glm::mat4 Renderer::getLightViewMatrix(const glm::vec3& lightPos, const glm::vec3& lightInvDir) {
+    // up vector cannot be parallel to light direction
+    glm::vec3 up{0, 1, 0};
+    if (glm::length2(glm::cross(lightInvDir, up)) < 0.001f) {
+        // cross product is roughly zero so vectors are parallel. choose a different up vector
+        up = glm::vec3{1, 0, 0};
+    }
+
+    return glm::lookAt(lightPos, lightPos - lightInvDir, up);
+}
+
+/**
+ * @brief compute the projection * view matrix used to render and sample a spot light's shadow map,
+ *      fitted to the part of the scene the light reaches. The frustum starts as the square around
+ *      the spot cone and is narrowed to the scene bounds as seen from the light, and near and far
+ *      enclose the scene bounds, so neither texels nor depth precision are spent on empty space.
+ *      Directional lights are fitted to the camera per cascade instead (see ShadowCascades).
+ * @param projection receives the projection alone
+ * @return false for light types without a single fixed shadow map
+ */
+bool Renderer::getLightViewProjMatrix(const SceneLightData& lightData, glm::mat4& viewProj, glm::mat4& projection) {
+    if (lightData.type != LightType::LIGHT_SPOT) {
+        viewProj = projection = glm::mat4(1.f);
+        return false;
+    }
+    glm::vec3 lightPos = lightData.pos;
+    glm::mat4 view = getLightViewMatrix(lightPos, -lightData.dir);
+
+    // extents on the plane one unit in front of the light; the angle is measured from the axis
+    float coneExtent = std::tan(std::clamp(lightData.angle, 0.01f, glm::radians(85.f)));
+    glm::vec2 low(-coneExtent), high(coneExtent);
+    float nearDepth = 0.1f;
+    float farDepth = 20.f;
+
+    // the light looks down -z
+    AABB lightBounds = m_sceneBounds.transformed(view);
+    if (!lightBounds.isEmpty() && lightBounds.min.z < 0.f) {
+        farDepth = -lightBounds.min.z;
+        // a light inside the scene still needs a near plane; keep the depth range within 1:100,
+        // which 16-bit depths resolve well enough
+        nearDepth = std::max(-lightBounds.max.z, farDepth * 0.01f);
+
+        if (lightBounds.max.z < 0.f) {
+            // the whole scene is in front of the light: no texel outside its silhouette is sampled
+            glm::vec2 sceneLow(std::numeric_limits<float>::max()), sceneHigh(-std::numeric_limits<float>::max());
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 p((corner & 1) ? lightBounds.max.x : lightBounds.min.x,
+                            (corner & 2) ? lightBounds.max.y : lightBounds.min.y,
+                            (corner & 4) ? lightBounds.max.z : lightBounds.min.z);
+                glm::vec2 projected = glm::vec2(p) / -p.z;
+                sceneLow = glm::min(sceneLow, projected);
+                sceneHigh = glm::max(sceneHigh, projected);
+            }
+            glm::vec2 fittedLow = glm::max(low, sceneLow);
+            glm::vec2 fittedHigh = glm::min(high, sceneHigh);
+            // a scene outside the cone is never lit, so its shadows do not matter
+            if (fittedLow.x < fittedHigh.x && fittedLow.y < fittedHigh.y) {
+                low = fittedLow;
+                high = fittedHigh;
+            }
+        }
+    }
+
+    projection = glm::frustum(low.x * nearDepth, high.x * nearDepth, low.y * nearDepth, high.y * nearDepth,
+                              nearDepth, farDepth);
+    viewProj = projection * view;
+    return true;
+}
+
+/**
+ * @brief look up every uniform location used by the draw loops once, after the programs are linked.
+ *      Sampler units never change, so they are assigned here as well.
+ */
+void Renderer::cacheUniformLocations() {
+    DefaultUniforms& u = m_defaultUniforms;
+    const ShaderProgram& p = m_defaultProgram;
+
+    u.positionOffset = p.getUniformLocation("positionOffset");
+    u.positionScale = p.getUniformLocation("positionScale");
+
+    u.shininess = p.getUniformLocation("shininess");
+    u.cAmbient = p.getUniformLocation("cAmbient");
+    u.cDiffuse = p.getUniformLocation("cDiffuse");
+    u.cSpecular = p.getUniformLocation("cSpecular");
+    u.blend = p.getUniformLocation("blend");
+
+    u.shadowAtlas = p.getUniformLocation("shadowAtlas");
+
+    TextureUniforms* textureUniforms[] = {&u.textures, &u.normals, &u.bumps};
+    std::string textureNames[] = {"myTextures", "myNormals", "myBumps"};
+    for (int i = 0; i < 3; i++) {
+        textureUniforms[i]->sampler = p.getUniformLocation(textureNames[i] + ".textureSampler");
+        textureUniforms[i]->isUsed = p.getUniformLocation(textureNames[i] + ".textureIsUsed");
+        textureUniforms[i]->repeat = p.getUniformLocation(textureNames[i] + ".textureRepeat");
+    }
+
+    m_shadowmapUniforms.layerMask = m_shadowmapProgram.getUniformLocation("layerMask");
+    m_shadowmapUniforms.positionOffset = m_shadowmapProgram.getUniformLocation("positionOffset");
+    m_shadowmapUniforms.positionScale = m_shadowmapProgram.getUniformLocation("positionScale");
+
+    for (ShaderProgram* program : {&m_defaultProgram, &m_shadowmapProgram}) {
+        program->bindUniformBlock("FrameData", UniformBlocks::FRAME_BINDING);
+        program->bindUniformBlock("LightData", UniformBlocks::LIGHTS_BINDING);
+        program->bindUniformBlock("ShadowData", UniformBlocks::SHADOW_BINDING);
+    }
+
+    // texture units: material textures on 0..2 (bound per material in activeTexture), depth maps after them
+    m_defaultProgram.use();
+    m_defaultProgram.setUniform(u.shadowAtlas, shadowTextureUnit);
+    m_defaultProgram.setUniform(u.textures.sampler, 0);
+    m_defaultProgram.setUniform(u.normals.sampler, 1);
+    m_defaultProgram.setUniform(u.bumps.sampler, 2);
+    glUseProgram(0);
+}
+
+/**
+ * @brief fill the per-frame block from the camera, global data and settings.
+ *      The buffer is only re-uploaded when one of them actually changed.
+ */
+void Renderer::updateFrameUniforms() {
+    UniformBlocks::FrameBlock frame{};
+    frame.viewMatrix = m_camera.getViewMatrix();
+    frame.projectionMatrix = m_camera.getProjMatrix();
+    frame.cameraPos = m_camera.getPos();
+    frame.ka = m_renderData.globalData.ka;
+    frame.kd = m_renderData.globalData.kd;
+    frame.ks = m_renderData.globalData.ks;
+    frame.numLights = std::min((int)m_renderData.lights.size(), maxLights);
+    frame.shadowsEnabled = settings.extraCredit1;
+    frame.fogEnabled = settings.extraCredit2;
+    frame.pcfTaps = settings.shadowFilterTaps;
+    frame.pcfRadius = settings.shadowFilterRadius;
+
+    m_frameUBO.update(frame);
+}
+
+/**
+ * @brief fill the light block and lay out the shadow map layers. Only does work when the lights
+ *      have changed (new scene, cascade count), since nothing in the scene animates them.
+ */
+void Renderer::updateLightUniforms() {
+    if (!m_lightsDirty) {
+        return;
+    }
+
+    UniformBlocks::LightsBlock lightsBlock{};
+
+    int numLights = std::min((int)m_renderData.lights.size(), maxLights);
+    for (int lightIndex = 0; lightIndex < numLights; lightIndex++) {
+        const SceneLightData& lightData = m_renderData.lights[lightIndex];
+
+        UniformBlocks::LightEntry& light = lightsBlock.lights[lightIndex];
+        light.lightType = static_cast<GLint>(lightData.type);
+        light.pos = lightData.pos;
+        light.dir = lightData.dir;
+        light.color = lightData.color;
+        light.attenCoeff = lightData.function;
+        light.angle = lightData.angle;
+        light.penumbra = lightData.penumbra;
+    }
+    allocateShadowLayers(lightsBlock);
+
+    m_lightsUBO.update(lightsBlock);
+    m_lightsDirty = false;
+}
+
+/**
+ * @brief give every directional light a layer per cascade and every spot light one layer, in light
+ *      order, up to MAX_SHADOW_LAYERS. Lights left without layers cast no shadows. Every layer
+ *      starts out dirty and gets its tile at the next atlas layout.
+ */
+void Renderer::allocateShadowLayers(UniformBlocks::LightsBlock& lightsBlock) {
+    int cascades = std::clamp(settings.shadowCascades, 1, ShadowCascades::MAX_CASCADES);
+    m_shadowLayers.clear();
+
+    int numLights = std::min((int)m_renderData.lights.size(), maxLights);
+    for (int lightIndex = 0; lightIndex < numLights; lightIndex++) {
+        UniformBlocks::LightEntry& light = lightsBlock.lights[lightIndex];
+        light.shadowLayer = -1;
+        light.shadowLayerCount = 0;
+
+        int layerCount = 0;
+        switch (m_renderData.lights[lightIndex].type) {
+        case LightType::LIGHT_DIRECTIONAL:
+            layerCount = cascades;
+            break;
+        case LightType::LIGHT_SPOT:
+            layerCount = 1;
+            break;
+        default:
+            // shadow maps not implemented for point lights
+            break;
+        }
+        if (layerCount == 0 || (int)m_shadowLayers.size() + layerCount > UniformBlocks::MAX_SHADOW_LAYERS) {
+            continue;
+        }
+
+        light.shadowLayer = m_shadowLayers.size();
+        light.shadowLayerCount = layerCount;
+        for (int layer = 0; layer < layerCount; layer++) {
+            ShadowLayer shadowLayer{};
+            shadowLayer.light = lightIndex;
+            shadowLayer.cascade = m_renderData.lights[lightIndex].type == LightType::LIGHT_DIRECTIONAL ? layer : -1;
+            // a zero matrix puts every point behind a layer that was never rendered
+            shadowLayer.viewProj = glm::mat4(0.f);
+            shadowLayer.dirty = true;
+            m_shadowLayers.push_back(shadowLayer);
+        }
+    }
+
+    m_shadowAtlasDirty = true;
+    m_nextShadowLayer = 0;
+}
+
+/**
+ * @brief make the framebuffer and the smallest shadow atlas; the atlas grows once the lights of a
+ *      scene are laid out. It does not depend on the window, so resizing keeps it.
+ */
+void Renderer::makeFBO() {
+    m_context->makeCurrent();
+    allocateShadowAtlas(shadowTileMin);
+    m_context->doneCurrent();
+}
+
+/**
+ * @brief (re)create the shadow framebuffer and a square depth texture holding every layer's tile.
+ *      Layers are placed in their tiles by shadowmap.geom, so the atlas is attached whole.
+ *      Depths are stored in 16 bits, which the fitted depth ranges leave enough precision, and
+ *      compared by the sampler: with linear filtering every lookup is a 2x2 percentage closer filter.
+ */
+void Renderer::allocateShadowAtlas(int size) {
+    GLint previousFramebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    if (m_haveMadeFBO) {
+        glDeleteTextures(1, &m_shadowAtlasTexture);
+        glDeleteFramebuffers(1, &m_shadowFBO);
+    }
+    m_shadowAtlasSize = size;
+
+    glGenFramebuffers(1, &m_shadowFBO);
+    glGenTextures(1, &m_shadowAtlasTexture);
+
+    glActiveTexture(GL_TEXTURE0 + shadowTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_shadowAtlasTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT16, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_stateCache.reset();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowAtlasTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    // check that our framebuffer is ok
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "makeFBO: issue with framebuffer: " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << std::endl;
+    }
+
+    // maps waiting for their first update cast no shadow rather than undefined ones
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+    m_haveMadeFBO = true;
+    invalidateShadowMaps();
+}
+
+void Renderer::invalidateShadowMaps() {
+    for (ShadowLayer& layer : m_shadowLayers) {
+        layer.dirty = true;
+    }
+}
+
+int Renderer::countDirtyShadowMaps() const {
+    return std::count_if(m_shadowLayers.begin(), m_shadowLayers.end(), [](const ShadowLayer& layer) {
+        return layer.dirty;
+    });
+}
+
+/**
+ * @brief compute the matrix every layer should be rendered with this frame. Spot lights do not
+ *      move; cascades follow the camera, and a layer whose target moved becomes dirty. Cascades are
+ *      snapped to texels of their tile, so small camera moves often leave them where they are.
+ *      The atlas is laid out in between, since the importance of spot lights depends on their
+ *      matrix and the snapping of cascades on their tile.
+ */
+void Renderer::updateShadowTargets() {
+    int cascades = std::clamp(settings.shadowCascades, 1, ShadowCascades::MAX_CASCADES);
+    m_cascades.update(m_camera, settings.nearPlane, settings.farPlane, cascades, settings.cascadeSplitBlend);
+
+    for (ShadowLayer& layer : m_shadowLayers) {
+        if (layer.cascade < 0) {
+            const SceneLightData& lightData = m_renderData.lights[layer.light];
+            getLightViewProjMatrix(lightData, layer.targetViewProj, layer.projection);
+            layer.eye = lightData.pos;
+        }
+        layer.importance = getShadowImportance(layer);
+    }
+    layoutShadowAtlas();
+
+    for (ShadowLayer& layer : m_shadowLayers) {
+        if (layer.cascade >= 0) {
+            const SceneLightData& lightData = m_renderData.lights[layer.light];
+            layer.targetViewProj = m_cascades.fit(lightData.dir, layer.cascade, m_sceneBounds, layer.tile.size, layer.projection);
+            // orthographic, the distance to the casters does not matter
+            layer.eye = m_camera.getPos();
+        }
+        if (layer.targetViewProj != layer.viewProj) {
+            layer.dirty = true;
+        }
+    }
+}
+
+/**
+ * @brief how much of the screen a layer's shadows can cover, from 0 to 1. Cascades are fitted to
+ *      the view, so they always matter fully. A spot light counts by the size of its lit volume
+ *      seen from the camera, and not at all if that volume is out of view.
+ */
+float Renderer::getShadowImportance(const ShadowLayer& layer) const {
+    if (layer.cascade >= 0) {
+        return 1.f;
+    }
+
+    // bounds of the light's frustum, whose depth range is already fitted to the scene
+    glm::mat4 clipToWorld = glm::inverse(layer.targetViewProj);
+    AABB litBounds;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec4 p = clipToWorld * glm::vec4((corner & 1) ? 1.f : -1.f, (corner & 2) ? 1.f : -1.f,
+                                              (corner & 4) ? 1.f : -1.f, 1.f);
+        litBounds.expand(glm::vec3(p) / p.w);
+    }
+    if (!Frustum(m_camera.getProjMatrix() * m_camera.getViewMatrix()).intersects(litBounds)) {
+        return 0.f;
+    }
+
+    // radius of the volume over the half height of the view at its distance
+    float radius = glm::length(litBounds.extent()) / 2.f;
+    float distance = std::max(glm::distance(litBounds.center(), glm::vec3(m_camera.getPos())), radius);
+    float coverage = radius / (distance * std::tan(m_camera.getHeightAngle() / 2.f));
+    return std::clamp(coverage, 0.f, 1.f);
+}
+
+/**
+ * @brief give every layer a tile of shadowTileMax scaled by its importance, rounded to a power of
+ *      two. A tile only changes size once the importance is more than shadowTileHysteresis of a
+ *      size step away from the current size, so lights near a step do not keep re-rendering. On
+ *      a new layout, layers whose tile moved are re-rendered, and all of them if the texture had
+ *      to be reallocated.
+ */
+void Renderer::layoutShadowAtlas() {
+    bool changed = m_shadowAtlasDirty;
+    for (ShadowLayer& layer : m_shadowLayers) {
+        float level = std::log2(std::max(shadowTileMax * layer.importance, (float)shadowTileMin));
+        if (layer.tileSize == 0 || std::abs(level - std::log2((float)layer.tileSize)) > shadowTileHysteresis) {
+            int tileSize = 1 << (int)std::round(level);
+            changed |= tileSize != layer.tileSize;
+            layer.tileSize = tileSize;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+    m_shadowAtlasDirty = false;
+
+    std::vector<int> tileSizes;
+    for (const ShadowLayer& layer : m_shadowLayers) {
+        tileSizes.push_back(layer.tileSize);
+    }
+    m_shadowAtlas.layout(tileSizes, shadowTileMin, m_shadowAtlasMax);
+    bool reallocate = m_shadowAtlas.getSize() != m_shadowAtlasSize;
+    if (reallocate) {
+        allocateShadowAtlas(m_shadowAtlas.getSize());
+    }
+
+    for (int layerIndex = 0; layerIndex < (int)m_shadowLayers.size(); layerIndex++) {
+        ShadowLayer& layer = m_shadowLayers[layerIndex];
+        const ShadowAtlas::Tile& tile = m_shadowAtlas.getTile(layerIndex);
+        if (reallocate || tile.x != layer.tile.x || tile.y != layer.tile.y || tile.size != layer.tile.size) {
+            layer.tile = tile;
+            layer.dirty = true;
+            layer.moved = true;
+        }
+    }
+}
+
+/**
+ * @brief pick the out of date layers to re-render this frame, round robin from where the last
+ *      frame stopped, until the estimated cost of the next one would exceed shadowUpdateBudgetMs.
+ *      At least one layer is picked per frame, so every layer is eventually updated whatever the
+ *      budget, and layers whose tile moved are always picked. The picked layers take their new
+ *      matrices; the others keep sampling with the ones they were rendered with. Layers are left
+ *      dirty while shadows are off.
+ * @return a bit per picked layer
+ */
+int Renderer::selectShadowLayers() {
+    m_shadowMapsUpdated = 0;
+    m_shadowCullStats = CullStats();
+
+    int layerMask = 0;
+    if (settings.extraCredit1) {
+        updateShadowTargets();
+
+        int numLayers = m_shadowLayers.size();
+        float plannedMs = 0.f;
+        int deferred = -1;                              // first layer left for a later frame
+        for (int n = 0; n < numLayers; n++) {
+            int layerIndex = (m_nextShadowLayer + n) % numLayers;
+            ShadowLayer& layer = m_shadowLayers[layerIndex];
+            if (!layer.dirty) continue;
+
+            // a moved layer has nothing left to sample, so it cannot wait
+            if (!layer.moved && layerMask != 0 && plannedMs + m_shadowMapCostMs > shadowUpdateBudgetMs) {
+                if (deferred < 0) deferred = layerIndex;
+                continue;
+            }
+            layerMask |= 1 << layerIndex;
+            layer.viewProj = layer.targetViewProj;
+            layer.dirty = false;
+            layer.moved = false;
+            plannedMs += m_shadowMapCostMs;
+            m_shadowMapsUpdated++;
+        }
+        m_nextShadowLayer = std::max(deferred, 0);
+    }
+
+    UniformBlocks::ShadowBlock shadowBlock{};
+    for (int layerIndex = 0; layerIndex < (int)m_shadowLayers.size(); layerIndex++) {
+        const glm::mat4& viewProj = m_shadowLayers[layerIndex].viewProj;
+        shadowBlock.lightVPs[layerIndex] = viewProj;
+        shadowBlock.depthBiasVPs[layerIndex] = m_biasMatrix * viewProj;
+        const ShadowAtlas::Tile& tile = m_shadowLayers[layerIndex].tile;
+        shadowBlock.atlasRects[layerIndex] = glm::vec4(tile.x, tile.y, tile.size, tile.size) / (float)m_shadowAtlasSize;
+    }
+    for (int cascade = 0; cascade < m_cascades.getCount(); cascade++) {
+        shadowBlock.cascadeSplits[cascade] = m_cascades.getSplit(cascade);
+    }
+    m_shadowUBO.update(shadowBlock);
+    return layerMask;
+}
+
+/**
+ * @brief render the picked layers together in one pass into the atlas and refine the cost
+ *      estimate of a layer from its timings.
+ */
+void Renderer::updateShadowMaps(int layerMask) {
+    if (layerMask == 0) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    renderShadowMaps(layerMask);
+    float cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    // the GPU time of the last pass the profiler has read back, which may have had other layers;
+    // close enough for a running estimate
+    float gpuMs = m_profiler.getLastSample("shadow maps", true);
+    m_shadowMapCostMs = glm::mix(m_shadowMapCostMs, std::max(cpuMs, gpuMs) / m_shadowMapsUpdated, 0.25f);
+}
+
+void Renderer::renderShadowMaps(int layerMask) {
+    m_profiler.beginGpu("shadow maps");
+    m_stateCache.useProgram(m_shadowmapProgram.getID());
+    m_shadowmapProgram.setUniform(m_shadowmapUniforms.layerMask, layerMask);
+
+    // the atlas being rendered must not stay bound for sampling
+    m_stateCache.bindTexture(shadowTextureUnit, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFBO);
+    glViewport(0, 0, m_shadowAtlasSize, m_shadowAtlasSize);
+
+    // clear only the tiles being rendered, the others keep their cached depths
+    glEnable(GL_SCISSOR_TEST);
+    for (int layerIndex = 0; layerIndex < (int)m_shadowLayers.size(); layerIndex++) {
+        if (layerMask & (1 << layerIndex)) {
+            const ShadowAtlas::Tile& tile = m_shadowLayers[layerIndex].tile;
+            glScissor(tile.x, tile.y, tile.size, tile.size);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+    }
+    glDisable(GL_SCISSOR_TEST);
+    // shadowmap.geom clips every triangle to the edges of its tile
+    for (int plane = 0; plane < 4; plane++) {
+        glEnable(GL_CLIP_DISTANCE0 + plane);
+    }
+
+    int cullingSection = m_profiler.beginCpu("culling");
+    // only instances inside one of the layers' frusta can cast into these maps, and levels of
+    // detail follow the largest size of the casters in any of them
+    std::vector<Frustum> lightFrusta;
+    std::vector<LodView> lightViews;
+    for (int layerIndex = 0; layerIndex < (int)m_shadowLayers.size(); layerIndex++) {
+        if (!(layerMask & (1 << layerIndex))) continue;
+        const ShadowLayer& layer = m_shadowLayers[layerIndex];
+        lightFrusta.push_back(Frustum(layer.viewProj));
+        lightViews.push_back(LodView(layer.projection, layer.eye, layer.tile.size, getLodBias()));
+    }
+    m_shadowCullStats = m_instanceBatcher.cull(lightFrusta);
+    m_instanceBatcher.selectLods(lightViews);
+    m_instanceBatcher.uploadVisible(m_streamBuffer);
+
+    // one instanced draw call per group, sorted by vao; there is no single eye to sort by depth from
+    const std::vector<InstanceGroup>& groups = m_instanceBatcher.getGroups();
+    m_renderQueue.clear();
+    for (int groupIndex = 0; groupIndex < (int)groups.size(); groupIndex++) {
+        const InstanceGroup& group = groups[groupIndex];
+        if (group.visible.empty()) continue;
+        m_renderQueue.push(RenderQueue::makeKey(RenderPass::PASS_SHADOW, 1, 0, 0, group.shapeId, 0.f), groupIndex);
+    }
+    // static chunks follow the groups in the item indices
+    m_staticBatcher.cull(lightFrusta);
+    for (int chunkIndex : m_staticBatcher.getVisibleChunks()) {
+        const StaticChunk& chunk = m_staticBatcher.getChunks()[chunkIndex];
+        m_renderQueue.push(RenderQueue::makeKey(RenderPass::PASS_SHADOW, 1, 0, 0, chunk.vaoId, 0.f), groups.size() + chunkIndex);
+    }
+    m_renderQueue.sort();
+    m_profiler.endCpu(cullingSection);
+    StaticBatcher::bindIdentityTransforms();
+
+    int submissionSection = m_profiler.beginCpu("submission");
+    for (const RenderItem& item : m_renderQueue.getItems()) {
+        if (item.index >= (int)groups.size()) {
+            const Shape& shape = m_staticBatcher.getChunks()[item.index - groups.size()].shape;
+            m_shadowmapProgram.setUniform(m_shadowmapUniforms.positionOffset, shape.positionOffset);
+            m_shadowmapProgram.setUniform(m_shadowmapUniforms.positionScale, shape.positionScale);
+            m_stateCache.bindVertexArray(shape.vao);
+            glDrawElements(GL_TRIANGLES, shape.indexCount, shape.indexType, nullptr);
+            m_stateCache.countDraw(1, shape.indexCount / 3);
+            continue;
+        }
+        const InstanceGroup& group = groups[item.index];
+        m_instanceBatcher.forEachLodRun(group, 0, group.visible.size(), [&](const Shape& shape, GLuint vao, int firstVisible, int count) {
+            m_shadowmapProgram.setUniform(m_shadowmapUniforms.positionOffset, shape.positionOffset);
+            m_shadowmapProgram.setUniform(m_shadowmapUniforms.positionScale, shape.positionScale);
+            m_stateCache.bindVertexArray(vao);
+            m_instanceBatcher.bindInstanceAttribs(group, firstVisible);
+            glDrawElementsInstanced(GL_TRIANGLES, shape.indexCount, shape.indexType, nullptr, count);
+            m_stateCache.countDraw(count, shape.indexCount / 3);
+        });
+    }
+    m_profiler.endCpu(submissionSection);
+
+    for (int plane = 0; plane < 4; plane++) {
+        glDisable(GL_CLIP_DISTANCE0 + plane);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+    m_profiler.endGpu();
+}
+
+/**
+ * @brief render a frame of the loaded scene into framebuffer, at the size given to resize.
+ */
+void Renderer::render(GLuint framebuffer) {
+    if (!m_sceneLoaded) {
+        return;
+    }
+    m_framebuffer = framebuffer;
+
+    m_profiler.beginFrame();
+    int frameSection = m_profiler.beginCpu("frame");
+    m_profiler.beginGpu("frame");
+
+    // per-frame data (uniform blocks, instance transforms) goes to this frame's stream region
+    m_streamBuffer.beginFrame();
+    m_defaultProgram.beginFrame();
+    m_shadowmapProgram.beginFrame();
+    m_frameUBO.beginFrame();
+    m_lightsUBO.beginFrame();
+    m_shadowUBO.beginFrame();
+    // Qt and texture uploads touch GL state between frames, so start from unknown state
+    m_stateCache.beginFrame();
+
+    int shadowLayerMask;
+    {
+        Profiler::CpuScope scope(m_profiler, "uniforms");
+        updateFrameUniforms();
+        updateLightUniforms();
+        shadowLayerMask = selectShadowLayers();
+        m_frameUBO.bind();
+        m_lightsUBO.bind();
+        m_shadowUBO.bind();
+    }
+
+    m_cameraCullStats = CullStats();
+
+    // Shadow map: render the layers that are out of date, as many as the budget allows
+    updateShadowMaps(shadowLayerMask);
+
+    // Students: anything requiring OpenGL calls every frame should be done here
+    m_profiler.beginGpu("main pass");
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_stateCache.useProgram(m_defaultProgram.getID());
+
+    m_stateCache.bindTexture(shadowTextureUnit, m_shadowAtlasTexture);
+
+    int cullingSection = m_profiler.beginCpu("culling");
+    glm::mat4 viewProj = m_camera.getProjMatrix() * m_camera.getViewMatrix();
+    m_cameraCullStats = m_instanceBatcher.cull(Frustum(viewProj));
+
+    m_softwareCullStats = CullStats();
+    if (settings.softwareOcclusion) {
+        // the largest visible shapes are rasterized on the CPU; shapes behind them are never submitted
+        m_softwareOcclusionCuller.render(m_instanceBatcher.getGroups(), viewProj, m_camera.getPos());
+        const std::vector<AABB>& shapeBounds = m_instanceBatcher.getShapeBounds();
+        m_instanceBatcher.filterVisible([&](int shapeIndex) {
+            bool occluded = m_softwareOcclusionCuller.isOccluded(shapeBounds[shapeIndex]);
+            (occluded ? m_softwareCullStats.culled : m_softwareCullStats.visible)++;
+            return !occluded;
+        });
+    }
+
+    m_occlusionCullStats = CullStats();
+    m_occlusionQueries = 0;
+    if (settings.occlusionCulling) {
+        // shapes hidden at their last query skip the main pass; they are queried and drawn
+        // conditionally after it (see renderOcclusionQueries)
+        m_occlusionCuller.beginFrame();
+        m_occludedShapes.clear();
+        m_retestShapes.clear();
+        m_instanceBatcher.filterVisible([&](int shapeIndex) {
+            if (m_occlusionCuller.isOccluded(shapeIndex)) {
+                m_occludedShapes.push_back(shapeIndex);
+                return false;
+            }
+            if (m_occlusionCuller.needsRetest(shapeIndex)) {
+                m_retestShapes.push_back(shapeIndex);
+            }
+            m_occlusionCullStats.visible++;
+            return true;
+        });
+        m_occlusionCullStats.culled = m_occludedShapes.size();
+    }
+
+    m_instanceBatcher.selectLods(LodView(m_camera.getProjMatrix(), m_camera.getPos(),
+                                         m_viewportHeight, getLodBias()), true);
+    m_instanceBatcher.uploadVisible(m_streamBuffer);
+
+    // sort the groups by texture set, material and vao, then front to back from the camera
+    const std::vector<InstanceGroup>& groups = m_instanceBatcher.getGroups();
+    glm::vec3 cameraPos(m_camera.getPos());
+    m_renderQueue.clear();
+    for (int groupIndex = 0; groupIndex < (int)groups.size(); groupIndex++) {
+        const InstanceGroup& group = groups[groupIndex];
+        if (group.visible.empty()) continue;
+        float depth = glm::distance(group.center, cameraPos) / settings.farPlane;
+        uint64_t key = RenderQueue::makeKey(RenderPass::PASS_OPAQUE, 0, group.textureSetId, group.materialId, group.shapeId, depth);
+        m_renderQueue.push(key, groupIndex);
+    }
+    // static chunks follow the groups in the item indices
+    m_staticCullStats = m_staticBatcher.cull(Frustum(viewProj));
+    for (int chunkIndex : m_staticBatcher.getVisibleChunks()) {
+        const StaticChunk& chunk = m_staticBatcher.getChunks()[chunkIndex];
+        float depth = glm::distance(chunk.shape.bounds.center(), cameraPos) / settings.farPlane;
+        uint64_t key = RenderQueue::makeKey(RenderPass::PASS_OPAQUE, 0, chunk.textureSetId, chunk.materialId, chunk.vaoId, depth);
+        m_renderQueue.push(key, groups.size() + chunkIndex);
+    }
+    m_renderQueue.sort();
+    m_profiler.endCpu(cullingSection);
+    StaticBatcher::bindIdentityTransforms();
+
+    int submissionSection = m_profiler.beginCpu("submission");
+    for (const RenderItem& item : m_renderQueue.getItems()) {
+        if (item.index >= (int)groups.size()) {
+            drawStaticChunk(m_staticBatcher.getChunks()[item.index - groups.size()]);
+            continue;
+        }
+        const InstanceGroup& group = groups[item.index];
+        drawGroup(group, 0, group.visible.size());
+    }
+    m_profiler.endCpu(submissionSection);
+    m_profiler.endGpu();
+
+    if (settings.occlusionCulling) {
+        m_profiler.beginGpu("occlusion queries");
+        renderOcclusionQueries();
+        m_profiler.endGpu();
+    }
+    m_stateCache.bindVertexArray(0);
+    m_stateCache.useProgram(0);
+    m_stateCache.endFrame();
+    m_streamBuffer.endFrame();
+
+    m_profiler.endGpu();
+    m_profiler.endCpu(frameSection);
+    m_profiler.endFrame();
+
+    if (m_logRenderStats) {
+        m_logRenderStats = false;
+        logRenderStats();
+    }
+}
+
+/**
+ * @brief set the material uniforms and textures of the default program, unless the material is
+ *      already current.
+ */
+void Renderer::bindMaterial(int materialId, const SceneMaterial& material) {
+    const DefaultUniforms& u = m_defaultUniforms;
+
+    if (m_stateCache.bindMaterial(materialId)) {
+        m_defaultProgram.setUniform(u.shininess, material.shininess);
+        m_defaultProgram.setUniform(u.cAmbient, material.cAmbient);
+        m_defaultProgram.setUniform(u.cDiffuse, material.cDiffuse);
+        m_defaultProgram.setUniform(u.cSpecular, material.cSpecular);
+        m_defaultProgram.setUniform(u.blend, material.blend);
+        activeTexture(material);
+    }
+}
+
+/**
+ * @brief draw visible instances [firstVisible, firstVisible + count) of an uploaded group with
+ *      the default program. Material uniforms and textures are only set when the material changes;
+ *      transforms come from the instance vbo.
+ */
+void Renderer::drawGroup(const InstanceGroup& group, int firstVisible, int count) {
+    const DefaultUniforms& u = m_defaultUniforms;
+    bindMaterial(group.materialId, group.material);
+
+    // one instanced draw per level of detail
+    m_instanceBatcher.forEachLodRun(group, firstVisible, count, [&](const Shape& shape, GLuint vao, int runFirst, int runCount) {
+        m_defaultProgram.setUniform(u.positionOffset, shape.positionOffset);
+        m_defaultProgram.setUniform(u.positionScale, shape.positionScale);
+        m_stateCache.bindVertexArray(vao);
+        m_instanceBatcher.bindInstanceAttribs(group, runFirst);
+        glDrawElementsInstanced(GL_TRIANGLES, shape.indexCount, shape.indexType, nullptr, runCount);
+        m_stateCache.countDraw(runCount, shape.indexCount / 3);
+    });
+}
+
+/**
+ * @brief draw a static chunk with the default program: one non-instanced draw of world-space
+ *      vertices. Requires StaticBatcher::bindIdentityTransforms() earlier in the pass.
+ */
+void Renderer::drawStaticChunk(const StaticChunk& chunk) {
+    const DefaultUniforms& u = m_defaultUniforms;
+    bindMaterial(chunk.materialId, chunk.material);
+
+    const Shape& shape = chunk.shape;
+    m_defaultProgram.setUniform(u.positionOffset, shape.positionOffset);
+    m_defaultProgram.setUniform(u.positionScale, shape.positionScale);
+    m_stateCache.bindVertexArray(shape.vao);
+    glDrawElements(GL_TRIANGLES, shape.indexCount, shape.indexType, nullptr);
+    m_stateCache.countDraw(1, shape.indexCount / 3);
+}
+
+/**
+ * @brief merge the static shapes into world-space chunks when static batching is on, or drop the
+ *      chunks when it is off. Merged shapes are left out of the instance groups' culling.
+ */
+void Renderer::buildStaticBatches() {
+    if (!settings.staticBatching) {
+        m_staticBatcher.finish(m_context);
+        m_instanceBatcher.setExcludedShapes({});
+        return;
+    }
+
+    int firstVaoId = 0;
+    for (const InstanceGroup& group : m_instanceBatcher.getGroups()) {
+        firstVaoId = std::max(firstVaoId, group.shapeId + 1);
+    }
+    m_staticBatcher.build(m_context, m_instanceBatcher.getGroups(), firstVaoId);
+    m_instanceBatcher.setExcludedShapes(m_staticBatcher.getBatchedShapes());
+}
+
+/**
+ * @brief the tessellation sliders no longer set a fixed tessellation. Their geometric mean,
+ *      relative to the default of 5, scales projected sizes before levels of detail are chosen.
+ */
+float Renderer::getLodBias() const {
+    return std::sqrt((float)settings.shapeParameter1 * settings.shapeParameter2) / 5.f;
+}
+
+/**
+ * @brief after the main pass: query the bounds of the shapes skipped as occluded and of the
+ *      visible shapes due for a re-test, then draw each skipped shape under conditional rendering
+ *      on its query. A skipped shape that became visible is thus still drawn this frame, while its
+ *      query result updates the occlusion state for the next frames.
+ */
+void Renderer::renderOcclusionQueries() {
+    m_queryShapes.assign(m_occludedShapes.begin(), m_occludedShapes.end());
+    m_queryShapes.insert(m_queryShapes.end(), m_retestShapes.begin(), m_retestShapes.end());
+    m_occlusionQueries = m_occlusionCuller.issueQueries(m_queryShapes, m_instanceBatcher.getShapeBounds(),
+                                                        m_camera.getPos(), settings.nearPlane, m_stateCache);
+    if (m_occludedShapes.empty()) {
+        return;
+    }
+
+    LodView cameraView(m_camera.getProjMatrix(), m_camera.getPos(), m_viewportHeight, getLodBias());
+    m_instanceBatcher.selectVisible(m_occludedShapes, cameraView);
+    m_instanceBatcher.uploadVisible(m_streamBuffer);
+    m_stateCache.useProgram(m_defaultProgram.getID());
+
+    // one draw per shape, since each one depends on its own query
+    for (const InstanceGroup& group : m_instanceBatcher.getGroups()) {
+        for (int k = 0; k < (int)group.visible.size(); k++) {
+            int shapeIndex = group.shapeIndices[group.visible[k]];
+            bool conditional = m_occlusionCuller.beginConditionalRender(shapeIndex);
+            drawGroup(group, k, 1);
+            if (conditional) {
+                m_occlusionCuller.endConditionalRender();
+            }
+        }
+    }
+}
+
+/**
+ * @brief print the draw and bind counters of the frame that was just rendered.
+ */
+void Renderer::logRenderStats() {
+    const RenderStats& stats = m_stateCache.getStats();
+    std::cout << "render queue: " << stats.drawCalls << " draw calls (" << stats.instances << " instances, "
+              << stats.triangles << " triangles), "
+              << stats.binds << " binds, " << stats.redundantBinds << " redundant binds skipped" << std::endl;
+
+    // programs latch their counters when a frame begins, so these are of the frame before
+    std::cout << "uniform updates (previous frame): default program " << m_defaultProgram.getUploadedUniformCount()
+              << " uploaded / " << m_defaultProgram.getSkippedUniformCount() << " skipped, shadow map program "
+              << m_shadowmapProgram.getUploadedUniformCount() << " uploaded / "
+              << m_shadowmapProgram.getSkippedUniformCount() << " skipped" << std::endl;
+
+    std::cout << "frustum culling: camera " << m_cameraCullStats.visible << " drawn / " << m_cameraCullStats.culled << " culled";
+    if (m_shadowMapsUpdated > 0) {
+        std::cout << ", shadow maps " << m_shadowCullStats.visible << " drawn / " << m_shadowCullStats.culled << " culled";
+    }
+    std::cout << std::endl;
+
+    if (settings.extraCredit1) {
+        std::cout << "shadow maps: " << m_shadowLayers.size() << " layers in a " << m_shadowAtlasSize << "x" << m_shadowAtlasSize << " atlas, " << m_shadowMapsUpdated << " updated, "
+                  << countDirtyShadowMaps() << " still out of date" << std::endl;
+    }
+
+    if (settings.softwareOcclusion) {
+        std::cout << "software occlusion culling: " << m_softwareCullStats.visible << " drawn / " << m_softwareCullStats.culled
+                  << " rejected, " << m_softwareOcclusionCuller.getOccluderCount() << " occluders ("
+                  << m_softwareOcclusionCuller.getOccluderTriangleCount() << " triangles)" << std::endl;
+    }
+    std::cout << "stream buffer: " << m_streamBuffer.getLastFrameUsage() / 1024 << " KiB this frame, "
+              << (m_streamBuffer.isPersistent() ? "persistently mapped" : "unsynchronized maps") << ", "
+              << m_streamBuffer.getWaitCount() << " waits for the GPU so far" << std::endl;
+    if (settings.staticBatching) {
+        std::cout << "static batching: " << m_staticCullStats.visible << " chunks drawn / " << m_staticCullStats.culled
+                  << " culled, " << m_staticBatcher.getBatchedShapes().size() << " shapes in "
+                  << m_staticBatcher.getMemoryUsage() / 1024 << " KiB" << std::endl;
+    }
+    if (settings.occlusionCulling) {
+        std::cout << "occlusion culling: " << m_occlusionCullStats.visible << " drawn / " << m_occlusionCullStats.culled
+                  << " rejected, " << m_occlusionQueries << " queries" << std::endl;
+    }
+}
+
+const RenderStats& Renderer::getRenderStats() const {
+    return m_stateCache.getStats();
+}
+
+const CullStats& Renderer::getOcclusionCullStats() const {
+    return m_occlusionCullStats;
+}
+
+/**
+ * @brief Helpers for textures
+ */
+// generate openGL textures and store ids to hash if textures are used
+void Renderer::createTextureAndNormal(){
+    m_context->makeCurrent();
+
+    vertexCreator::createTexture(m_textures, m_renderData.shapes);
+    vertexCreator::createNormalText(m_normalTextures, m_renderData.shapes);
+    vertexCreator::createBumpText(m_bumpTextures, m_renderData.shapes);
+
+    m_context->doneCurrent();
+}
+
+// active texture slots and pass uniforms to fragment shader
+void Renderer::activeTexture(const SceneMaterial& shapeMat){
+    const DefaultUniforms& u = m_defaultUniforms;
+
+    if(shapeMat.textureMap.isUsed){
+        GLuint textureId = m_textures[shapeMat.textureMap.filename];
+        m_stateCache.bindTexture(0, textureId);
+
+        m_defaultProgram.setUniform(u.textures.isUsed, true);
+        m_defaultProgram.setUniform(u.textures.repeat, glm::vec2(shapeMat.textureMap.repeatU, shapeMat.textureMap.repeatV));
+    }
+    else{
+        m_defaultProgram.setUniform(u.textures.isUsed, false);
+    }
+
+    if(shapeMat.normalMap.isUsed){
+        GLuint normalId = m_normalTextures[shapeMat.normalMap.filename];
+        m_stateCache.bindTexture(1, normalId);
+
+        m_defaultProgram.setUniform(u.normals.isUsed, true);
+        m_defaultProgram.setUniform(u.normals.repeat, glm::vec2(shapeMat.normalMap.repeatU, shapeMat.normalMap.repeatV));
+    }
+    else{
+        m_defaultProgram.setUniform(u.normals.isUsed, false);
+    }
+
+    if(shapeMat.bumpMap.isUsed){
+        GLuint bumpId = m_bumpTextures[shapeMat.bumpMap.filename];
+        m_stateCache.bindTexture(2, bumpId);
+
+        m_defaultProgram.setUniform(u.bumps.isUsed, true);
+        m_defaultProgram.setUniform(u.bumps.repeat, glm::vec2(shapeMat.bumpMap.repeatU, shapeMat.bumpMap.repeatV));
+    }
+    else{
+        m_defaultProgram.setUniform(u.bumps.isUsed, false);
+    }
+}
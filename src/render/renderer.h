@@ -0,0 +1,215 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#include "shapes/shapemanager.h"
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+
+#include "utils/glcontext.h"
+#include "utils/sceneparser.h"
+#include "utils/shaderprogram.h"
+#include "utils/uniformblocks.h"
+#include "utils/streambuffer.h"
+#include "utils/uniformbuffer.h"
+#include "utils/profiler.h"
+#include "camera/camera.h"
+#include "render/glstatecache.h"
+#include "render/instancebatcher.h"
+#include "render/occlusionculler.h"
+#include "render/softwareocclusionculler.h"
+#include "render/staticbatcher.h"
+#include "render/renderqueue.h"
+#include "render/shadowatlas.h"
+#include "render/shadowcascades.h"
+
+// Loads a scene and renders it with shadow maps into a given framebuffer.
+// Holds everything that does not depend on a window, so the same frames can be produced by the
+// interactive widget (Realtime) and by the headless benchmark. Reads the global settings.
+class Renderer
+{
+public:
+    Renderer();
+
+    // initializes GLEW and the GL objects that outlive scenes; context must be current
+    void init(GLContext* context);
+    void finish();
+
+    // parse settings.sceneFilePath and upload its shapes and textures
+    void loadScene();
+    // apply changed settings (camera planes, static batching)
+    void settingsChanged();
+    // size of the render target in pixels; the camera aspect ratio follows width / height
+    void resize(int width, int height);
+    void render(GLuint framebuffer);
+
+    bool isSceneLoaded() const;
+    // whether the last frame left work for later frames (shadow maps still out of date)
+    bool hasPendingUpdates() const;
+    Camera& getCamera();
+    // nearest shape hit by the camera ray through a point in normalized device coordinates, or -1
+    int pickShape(glm::vec2 ndc);
+
+    // draw / bind counters of the last complete frame
+    const RenderStats& getRenderStats() const;
+    // main pass shapes drawn / rejected by occlusion culling in the last frame
+    const CullStats& getOcclusionCullStats() const;
+    Profiler& getProfiler();
+
+private:
+    GLContext* m_context = nullptr;
+    GLuint m_framebuffer = 0;                           // target of the frame being rendered
+    int m_viewportWidth = 1;
+    int m_viewportHeight = 1;
+
+    RenderData m_renderData;
+    SceneParser m_sceneParser;
+    ShapeManager m_shapeManager;
+    InstanceBatcher m_instanceBatcher;
+    RenderQueue m_renderQueue;
+    GLStateCache m_stateCache;
+    bool m_logRenderStats = false;                      // print the counters of the first frame after a scene load
+    CullStats m_cameraCullStats;
+    CullStats m_shadowCullStats;
+    void logRenderStats();
+
+    // per-pass CPU and GPU timings
+    Profiler m_profiler;
+
+    SoftwareOcclusionCuller m_softwareOcclusionCuller;
+    CullStats m_softwareCullStats;
+
+    OcclusionCuller m_occlusionCuller;
+    CullStats m_occlusionCullStats;
+    int m_occlusionQueries = 0;
+    std::vector<int> m_occludedShapes;                  // skipped in the main pass, drawn conditionally
+    std::vector<int> m_retestShapes;                    // drawn in the main pass and queried again
+    std::vector<int> m_queryShapes;
+    void renderOcclusionQueries();
+
+    StaticBatcher m_staticBatcher;
+    CullStats m_staticCullStats;
+    bool prevStaticBatching = false;
+    void buildStaticBatches();
+
+    void bindMaterial(int materialId, const SceneMaterial& material);
+    void drawGroup(const InstanceGroup& group, int firstVisible, int count);
+    void drawStaticChunk(const StaticChunk& chunk);
+    float getLodBias() const;
+    bool m_sceneLoaded = false;
+    void parseScene();
+    Camera m_camera;
+
+    float prevNearPlane = -1;
+    float prevFarPlane = -1;
+
+
+    ShaderProgram m_defaultProgram;
+    ShaderProgram m_shadowmapProgram;
+
+    // A shadow map layer: a spot light's map or one cascade of a directional light, held in a tile
+    // of the shadow atlas. Until a layer is re-rendered it is sampled with the matrix it was
+    // rendered with.
+    struct ShadowLayer {
+        int light;
+        int cascade;                                    // -1 for spot lights
+        glm::mat4 viewProj;                             // what the layer holds
+        glm::mat4 targetViewProj;                       // what it should hold this frame
+        glm::mat4 projection;                           // part of targetViewProj, for levels of detail
+        glm::vec3 eye;
+        float importance;                               // 0..1, picks the tile size
+        int tileSize;                                   // requested from the atlas, 0 before the first layout
+        ShadowAtlas::Tile tile;
+        bool dirty;
+        bool moved;                                     // its tile changed and holds nothing yet
+    };
+    std::vector<ShadowLayer> m_shadowLayers;
+    ShadowCascades m_cascades;
+    AABB m_sceneBounds;                                 // of every shape, to keep casters in front of the cascades
+    void allocateShadowLayers(UniformBlocks::LightsBlock& lightsBlock);
+    void updateShadowTargets();
+    float getShadowImportance(const ShadowLayer& layer) const;
+
+    // Every layer gets a tile of one depth texture, sized by its importance on screen. The atlas
+    // grows and shrinks with the tiles, so memory follows the lights of the scene.
+    ShadowAtlas m_shadowAtlas;
+    bool m_shadowAtlasDirty = true;                     // layers were added or removed
+    void layoutShadowAtlas();
+
+    // Shadow maps are cached: a layer is only re-rendered once its light, the geometry or the level
+    // of detail bias changes, or its cascade moves with the camera, and then round robin under a
+    // per-frame time budget.
+    int m_nextShadowLayer = 0;                          // first layer considered by the next update
+    int m_shadowMapsUpdated = 0;                        // in the last frame
+    float m_shadowMapCostMs = 1.f;                      // running estimate of one layer, CPU or GPU
+    constexpr static float shadowUpdateBudgetMs = 4.f;
+    float prevLodBias = -1;
+    int prevShadowCascades = -1;
+    void invalidateShadowMaps();
+    // pick the layers to re-render this frame and fill the shadow block; returns their bits
+    int selectShadowLayers();
+    void updateShadowMaps(int layerMask);
+    // render the layers whose bits are set, all in one submission
+    void renderShadowMaps(int layerMask);
+    int countDirtyShadowMaps() const;
+    bool m_haveMadeFBO = false;
+    void makeFBO();
+    // (re)create the atlas texture; needs a current context
+    void allocateShadowAtlas(int size);
+    int m_shadowAtlasSize = 0;                          // of the texture, which may lag the layout
+
+    constexpr static int maxLights = UniformBlocks::MAX_LIGHTS;
+    // material textures use units 0..2, depth maps follow them
+    const static int shadowTextureUnit = 3;
+    GLuint m_shadowAtlasTexture;
+    GLuint m_shadowFBO;
+    // tile sizes; cascades always get the largest, spot lights scale with their importance
+    constexpr static int shadowTileMin = 128;
+    constexpr static int shadowTileMax = 1024;
+    constexpr static float shadowTileHysteresis = 0.75f;   // in powers of two
+    int m_shadowAtlasMax = 8192;                        // lowered to GL_MAX_TEXTURE_SIZE at init
+
+    // uniform locations resolved once after linking, so the draw loops never build uniform names
+    struct TextureUniforms {
+        GLint sampler, isUsed, repeat;
+    };
+    struct DefaultUniforms {
+        GLint positionOffset, positionScale;
+        GLint shininess, cAmbient, cDiffuse, cSpecular, blend;
+        GLint shadowAtlas;
+        TextureUniforms textures, normals, bumps;
+    } m_defaultUniforms;
+    struct ShadowmapUniforms {
+        GLint layerMask;
+        GLint positionOffset, positionScale;
+    } m_shadowmapUniforms;
+    void cacheUniformLocations();
+
+    // per-frame data: uniform blocks and instance transforms are written to a fenced ring
+    StreamBuffer m_streamBuffer;
+    constexpr static GLsizeiptr streamRegionSize = 1 << 20;
+
+    // std140 blocks shared by every program (see resources/shaders/uniforms.glsl)
+    UniformBuffer m_frameUBO;
+    UniformBuffer m_lightsUBO;
+    UniformBuffer m_shadowUBO;
+    bool m_lightsDirty = true;
+    void updateFrameUniforms();
+    void updateLightUniforms();
+
+    glm::mat4 m_biasMatrix;
+    glm::mat4 getLightViewMatrix(const glm::vec3& lightPos, const glm::vec3& lightInvDir);
+    bool getLightViewProjMatrix(const SceneLightData& lightData, glm::mat4& viewProj, glm::mat4& projection);
+
+    // textures
+    std::unordered_map<std::string, GLuint> m_textures; // hash for texture filename and texture id
+    std::unordered_map<std::string, GLuint> m_normalTextures; // hash for normal texture filename and normal texture id
+    std::unordered_map<std::string, GLuint> m_bumpTextures; // hash for bump texture filename and bump texture id
+    void createTextureAndNormal();
+    void activeTexture(const SceneMaterial& shapeMat);
+};
@@ -0,0 +1,73 @@
+#include "renderqueue.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+uint64_t field(int value, int bits) {
+    return static_cast<uint64_t>(value) & ((uint64_t(1) << bits) - 1);
+}
+
+}
+
+/**
+ * @brief pack the state a draw needs into a key whose numeric order is the submission order.
+ *      Expensive state changes sit in the high bits so sorting minimizes them; depth comes last
+ *      so draws that share all state are submitted front to back.
+ */
+uint64_t RenderQueue::makeKey(RenderPass pass, int program, int textureSet, int material, int vao, float depth) {
+    uint64_t quantizedDepth = static_cast<uint64_t>(std::clamp(depth, 0.f, 1.f) * 65535.f);
+
+    return field(static_cast<int>(pass), 4) << 60 |
+           field(program, 4) << 56 |
+           field(textureSet, 12) << 44 |
+           field(material, 12) << 32 |
+           field(vao, 16) << 16 |
+           quantizedDepth;
+}
+
+void RenderQueue::clear() {
+    m_items.clear();
+}
+
+void RenderQueue::push(uint64_t key, int index) {
+    m_items.push_back(RenderItem{key, index});
+}
+
+/**
+ * @brief stable LSD radix sort on the key, one byte per pass.
+ *      Passes over bytes that are identical for every item (e.g. the pass and program bytes of a
+ *      single-pass queue) are skipped, so typical queues take far fewer than 8 passes.
+ */
+void RenderQueue::sort() {
+    if (m_items.size() < 2) {
+        return;
+    }
+    m_scratch.resize(m_items.size());
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        std::array<size_t, 256> counts{};
+        for (const RenderItem& item : m_items) {
+            counts[(item.key >> shift) & 0xff]++;
+        }
+        if (counts[(m_items[0].key >> shift) & 0xff] == m_items.size()) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t& count : counts) {
+            size_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+        for (const RenderItem& item : m_items) {
+            m_scratch[counts[(item.key >> shift) & 0xff]++] = item;
+        }
+        m_items.swap(m_scratch);
+    }
+}
+
+const std::vector<RenderItem>& RenderQueue::getItems() const {
+    return m_items;
+}
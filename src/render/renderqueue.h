@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Passes in submission order. The pass occupies the top bits of the sort key.
+enum class RenderPass : uint8_t {
+    PASS_SHADOW = 0,
+    PASS_OPAQUE = 1
+};
+
+struct RenderItem {
+    uint64_t key;
+    // index of the draw in the caller's list (e.g. InstanceBatcher::getGroups())
+    int index;
+};
+
+// A list of draws that is radix-sorted by a 64-bit key before submission, so that draws sharing
+// GL state end up next to each other. Key layout, most significant field first:
+//   pass (4) | program (4) | texture set (12) | material (12) | vao (16) | depth (16)
+class RenderQueue
+{
+public:
+    // ids are truncated to their field width; depth is clamped to [0, 1] with 0 nearest
+    static uint64_t makeKey(RenderPass pass, int program, int textureSet, int material, int vao, float depth);
+
+    void clear();
+    void push(uint64_t key, int index);
+    void sort();
+
+    const std::vector<RenderItem>& getItems() const;
+
+private:
+    std::vector<RenderItem> m_items;
+    std::vector<RenderItem> m_scratch;
+};
@@ -0,0 +1,67 @@
+#include "shadowatlas.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// every other bit of a Z-order index, starting at the lowest
+int compactBits(long long index) {
+    int result = 0;
+    for (int bit = 0; index != 0; bit++, index >>= 2) {
+        result |= (int)(index & 1) << bit;
+    }
+    return result;
+}
+
+}
+
+bool ShadowAtlas::layout(const std::vector<int>& tileSizes, int minSize, int maxSize) {
+    std::vector<int> sizes(tileSizes);
+    auto totalArea = [&]() {
+        long long area = 0;
+        for (int size : sizes) {
+            area += (long long)size * size;
+        }
+        return area;
+    };
+    while (totalArea() > (long long)maxSize * maxSize) {
+        int& largest = *std::max_element(sizes.begin(), sizes.end());
+        if (largest <= 1) break;
+        largest /= 2;
+    }
+
+    int atlasSize = minSize;
+    while (atlasSize < maxSize && (long long)atlasSize * atlasSize < totalArea()) {
+        atlasSize *= 2;
+    }
+
+    std::vector<int> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return sizes[a] > sizes[b];
+    });
+
+    m_tiles.assign(sizes.size(), Tile());
+    long long offset = 0;                               // texels along the Z-order curve
+    for (int index : order) {
+        long long tileArea = (long long)sizes[index] * sizes[index];
+        long long node = offset / tileArea;
+        m_tiles[index].x = compactBits(node) * sizes[index];
+        m_tiles[index].y = compactBits(node >> 1) * sizes[index];
+        m_tiles[index].size = sizes[index];
+        offset += tileArea;
+    }
+
+    bool changed = atlasSize != m_size;
+    m_size = atlasSize;
+    return changed;
+}
+
+int ShadowAtlas::getSize() const {
+    return m_size;
+}
+
+const ShadowAtlas::Tile& ShadowAtlas::getTile(int index) const {
+    return m_tiles[index];
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+// Packs square shadow map tiles of power-of-two sizes into one square texture.
+// Tiles are placed largest first along the Z-order curve of a quadtree: a tile of size s starts
+// at a multiple of s² along the curve, which is always a free, aligned node of the quadtree, so
+// tiles whose areas add up to at most the atlas area always fit without gaps.
+class ShadowAtlas
+{
+public:
+    struct Tile {
+        int x = 0;
+        int y = 0;
+        int size = 0;
+    };
+
+    // Lay out tiles of the requested sizes in the smallest power-of-two atlas, between minSize and
+    // maxSize, that holds them. While they do not fit in maxSize, the largest tile is halved.
+    // Requests are processed in order among tiles of the same size, so the same requests give the
+    // same layout.
+    // @return whether the atlas size changed
+    bool layout(const std::vector<int>& tileSizes, int minSize, int maxSize);
+
+    int getSize() const;
+    // in the order of the requests; the size may be smaller than requested
+    const Tile& getTile(int index) const;
+
+private:
+    std::vector<Tile> m_tiles;
+    int m_size = 0;
+};
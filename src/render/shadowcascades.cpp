@@ -0,0 +1,91 @@
+#include "shadowcascades.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/norm.hpp>
+
+/**
+ * @brief compute the split distances and the bounding sphere of every slice. A slice of a
+ *      symmetric frustum between depths n and f has its corners at distance k * depth from the
+ *      view axis; the smallest enclosing sphere is centered on the axis at (n + f)(1 + k²) / 2,
+ *      or at f if that is further.
+ */
+void ShadowCascades::update(const Camera& camera, float nearPlane, float farPlane, int count, float splitBlend) {
+    m_count = std::clamp(count, 1, MAX_CASCADES);
+
+    float tanHeight = std::tan(camera.getHeightAngle() / 2.f);
+    float tanWidth = tanHeight * camera.getAspectRatio();
+    float k2 = tanHeight * tanHeight + tanWidth * tanWidth;
+
+    glm::vec3 pos(camera.getPos());
+    glm::vec3 look = glm::normalize(camera.getLook());
+
+    float sliceNear = nearPlane;
+    for (int cascade = 0; cascade < m_count; cascade++) {
+        float t = (float)(cascade + 1) / m_count;
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+        float sliceFar = glm::mix(uniformSplit, logSplit, splitBlend);
+        m_splits[cascade] = sliceFar;
+
+        float centerDepth = std::min((sliceNear + sliceFar) * (1.f + k2) / 2.f, sliceFar);
+        float dFar = sliceFar - centerDepth;
+        m_slices[cascade].center = pos + look * centerDepth;
+        m_slices[cascade].radius = std::sqrt(dFar * dFar + sliceFar * sliceFar * k2);
+
+        sliceNear = sliceFar;
+    }
+}
+
+int ShadowCascades::getCount() const {
+    return m_count;
+}
+
+float ShadowCascades::getSplit(int cascade) const {
+    return m_splits[cascade];
+}
+
+/**
+ * @brief fit an orthographic shadow map to a slice, clamped to the scene bounds seen from the light.
+ *      The sides follow the slice's sphere, snapped to texels, unless the whole scene fits inside
+ *      them; the scene does not move, so its own bounds are just as stable and give more texels.
+ *      Casters and receivers all lie in the scene bounds, so the depth range is clamped to them.
+ */
+glm::mat4 ShadowCascades::fit(const glm::vec3& lightDir, int cascade, const AABB& sceneBounds, int resolution, glm::mat4& projection) const {
+    // a light space that only depends on the light, so snapping in it is stable
+    glm::vec3 dir = glm::normalize(lightDir);
+    glm::vec3 up{0, 1, 0};
+    if (glm::length2(glm::cross(dir, up)) < 0.001f) {
+        up = glm::vec3{1, 0, 0};
+    }
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f), dir, up);
+
+    const Slice& slice = m_slices[cascade];
+    glm::vec3 center = glm::vec3(view * glm::vec4(slice.center, 1.f));
+    float texel = 2.f * slice.radius / resolution;
+    center.x = std::floor(center.x / texel) * texel;
+    center.y = std::floor(center.y / texel) * texel;
+
+    glm::vec2 low = glm::vec2(center) - slice.radius;
+    glm::vec2 high = glm::vec2(center) + slice.radius;
+    // light space looks down -z
+    float nearDepth = -center.z - slice.radius;
+    float farDepth = -center.z + slice.radius;
+    if (!sceneBounds.isEmpty()) {
+        AABB lightBounds = sceneBounds.transformed(view);
+        glm::vec2 sceneLow = glm::vec2(lightBounds.min) - texel;
+        glm::vec2 sceneHigh = glm::vec2(lightBounds.max) + texel;
+        if (glm::all(glm::greaterThanEqual(sceneLow, low)) && glm::all(glm::lessThanEqual(sceneHigh, high))) {
+            low = sceneLow;
+            high = sceneHigh;
+        }
+        // casters between the light and the slice must stay in front of the near plane
+        nearDepth = -lightBounds.max.z;
+        farDepth = std::max(std::min(farDepth, -lightBounds.min.z), nearDepth + 0.01f);
+    }
+
+    projection = glm::ortho(low.x, high.x, low.y, high.y, nearDepth, farDepth);
+    return projection * view;
+}
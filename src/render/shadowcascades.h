@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "camera/camera.h"
+#include "utils/aabb.h"
+#include "utils/uniformblocks.h"
+
+// Cascaded shadow maps for directional lights: the camera's view range is split into slices and
+// every directional light gets one orthographic shadow map per slice.
+// Each map is fitted to the bounding sphere of its slice, which does not change size as the camera
+// turns, and its position is snapped to whole texels, so shadow edges do not shimmer while moving.
+class ShadowCascades
+{
+public:
+    static constexpr int MAX_CASCADES = UniformBlocks::MAX_CASCADES;
+
+    // split [nearPlane, farPlane] into count slices. splitBlend mixes the uniform split (0) with
+    // the logarithmic one (1), which gives near slices more of the resolution.
+    void update(const Camera& camera, float nearPlane, float farPlane, int count, float splitBlend);
+
+    int getCount() const;
+    // view-space distance at which a cascade ends
+    float getSplit(int cascade) const;
+
+    // Light projection * view covering a slice for a light shining along lightDir, no larger than
+    // sceneBounds; the depth range reaches towards the light to include every caster in it.
+    // @param projection receives the orthographic projection alone, e.g. for level of detail selection
+    glm::mat4 fit(const glm::vec3& lightDir, int cascade, const AABB& sceneBounds, int resolution, glm::mat4& projection) const;
+
+private:
+    struct Slice {
+        glm::vec3 center;
+        float radius;
+    };
+    Slice m_slices[MAX_CASCADES];
+    float m_splits[MAX_CASCADES] = {};
+    int m_count = 0;
+};
@@ -0,0 +1,384 @@
+#include "softwareocclusionculler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SOFTWARE_OCCLUSION_SSE 1
+#endif
+
+namespace {
+
+// clip space w below which a vertex counts as behind the camera
+const float MIN_CLIP_W = 1e-4f;
+
+// growth of occluder triangles, in pixels
+const float EDGE_EPSILON = 1e-3f;
+
+// occluders must cover at least this much of the view (bounds diagonal / distance)
+const float MIN_OCCLUDER_SIZE = 0.25f;
+
+/**
+ * @brief true if any of the depths in row[x0, x1] is at least depth, i.e. something at that
+ *      depth would still be visible there.
+ */
+bool anyDepthAtLeast(const float* row, int x0, int x1, float depth) {
+    int x = x0;
+#ifdef SOFTWARE_OCCLUSION_SSE
+    __m128 reference = _mm_set1_ps(depth);
+    for (; x + 3 <= x1; x += 4) {
+        if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), reference)) != 0) {
+            return true;
+        }
+    }
+#endif
+    for (; x <= x1; x++) {
+        if (row[x] >= depth) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+/**
+ * @brief allocate the depth buffer and start one worker per extra band. The band count is
+ *      limited by the hardware threads and by the number of tile rows.
+ */
+SoftwareOcclusionCuller::SoftwareOcclusionCuller()
+    : m_depth(WIDTH * HEIGHT, 1.f),
+      m_tileMaxDepth(TILES_X * TILES_Y, 1.f)
+{
+    int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    m_numBands = std::clamp(hardwareThreads, 1, std::min(4, TILES_Y));
+    for (int band = 1; band < m_numBands; band++) {
+        m_workers.emplace_back(&SoftwareOcclusionCuller::workerLoop, this, band);
+    }
+}
+
+SoftwareOcclusionCuller::~SoftwareOcclusionCuller() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_startCondition.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief pick this frame's occluders, transform their triangles to the screen and rasterize them.
+ * @param groups hold the visible instances of the camera frustum cull
+ */
+void SoftwareOcclusionCuller::render(const std::vector<InstanceGroup>& groups, const glm::mat4& viewProj, const glm::vec3& cameraPos) {
+    m_viewProj = viewProj;
+    selectOccluders(groups, cameraPos);
+    setupTriangles(groups);
+    runBands();
+}
+
+/**
+ * @brief rank the visible instances by how large their bounds appear from the camera and keep the
+ *      biggest ones whose meshes are cheap enough to rasterize.
+ */
+void SoftwareOcclusionCuller::selectOccluders(const std::vector<InstanceGroup>& groups, const glm::vec3& cameraPos) {
+    struct Candidate {
+        float size;
+        int group, instance;
+    };
+    std::vector<Candidate> candidates;
+
+    for (int groupIndex = 0; groupIndex < (int)groups.size(); groupIndex++) {
+        const InstanceGroup& group = groups[groupIndex];
+        if (group.shape->indexCount / 3 > MAX_OCCLUDER_TRIANGLES) continue;
+
+        for (int instance : group.visible) {
+            const AABB& bounds = group.instanceBounds[instance];
+            float distance = std::max(glm::distance(bounds.center(), cameraPos), 1e-3f);
+            float size = glm::length(bounds.extent()) / distance;
+            if (size >= MIN_OCCLUDER_SIZE) {
+                candidates.push_back({size, groupIndex, instance});
+            }
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.size > b.size;
+    });
+
+    m_occluders.clear();
+    int numTriangles = 0;
+    for (const Candidate& candidate : candidates) {
+        if ((int)m_occluders.size() == MAX_OCCLUDERS) break;
+        int shapeTriangles = groups[candidate.group].shape->indexCount / 3;
+        if (numTriangles + shapeTriangles > MAX_TOTAL_TRIANGLES) continue;
+        numTriangles += shapeTriangles;
+        m_occluders.push_back({candidate.group, candidate.instance});
+    }
+}
+
+/**
+ * @brief transform the occluder meshes (from the shapes' CPU vertex data) to buffer pixels.
+ *      Back faces, triangles crossing the near plane and triangles off screen are dropped;
+ *      dropping occluder triangles only ever makes the culling more conservative.
+ */
+void SoftwareOcclusionCuller::setupTriangles(const std::vector<InstanceGroup>& groups) {
+    m_triangles.clear();
+
+    for (auto [groupIndex, instance] : m_occluders) {
+        const InstanceGroup& group = groups[groupIndex];
+        const std::vector<GLfloat>& vertexData = *group.shape->getVertexData();
+        const std::vector<GLuint>& indexData = *group.shape->getIndexData();
+        glm::mat4 modelViewProj = m_viewProj * group.instances[instance].modelMatrix;
+
+        int numVertices = vertexData.size() / SOURCE_VERTEX_FLOATS;
+        m_clipPositions.resize(numVertices);
+        for (int vertex = 0; vertex < numVertices; vertex++) {
+            const GLfloat* position = &vertexData[vertex * SOURCE_VERTEX_FLOATS];
+            m_clipPositions[vertex] = modelViewProj * glm::vec4(position[0], position[1], position[2], 1.f);
+        }
+
+        for (size_t i = 0; i + 2 < indexData.size(); i += 3) {
+            Triangle triangle;
+            bool clipped = false;
+            for (int corner = 0; corner < 3; corner++) {
+                const glm::vec4& clip = m_clipPositions[indexData[i + corner]];
+                if (clip.w < MIN_CLIP_W || clip.z < -clip.w) {
+                    clipped = true;
+                    break;
+                }
+                glm::vec3 ndc = glm::vec3(clip) / clip.w;
+                triangle.v[corner] = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH,
+                                               (ndc.y * 0.5f + 0.5f) * HEIGHT,
+                                               ndc.z * 0.5f + 0.5f);
+            }
+            if (clipped) continue;
+
+            const glm::vec3& a = triangle.v[0];
+            const glm::vec3& b = triangle.v[1];
+            const glm::vec3& c = triangle.v[2];
+            float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+            if (area <= 0.f) continue;
+
+            glm::vec2 low = glm::min(glm::vec2(a), glm::min(glm::vec2(b), glm::vec2(c)));
+            glm::vec2 high = glm::max(glm::vec2(a), glm::max(glm::vec2(b), glm::vec2(c)));
+            if (high.x < 0.f || high.y < 0.f || low.x > WIDTH || low.y > HEIGHT) continue;
+
+            m_triangles.push_back(triangle);
+        }
+    }
+}
+
+/**
+ * @brief rasterize every triangle into one band of the buffer, then rebuild the tile maxima of
+ *      that band. Bands are whole tile rows, so no two threads touch the same tile.
+ */
+void SoftwareOcclusionCuller::rasterizeBand(int band) {
+    int tileRowBegin = band * TILES_Y / m_numBands;
+    int tileRowEnd = (band + 1) * TILES_Y / m_numBands;
+    int rowBegin = tileRowBegin * TILE_SIZE;
+    int rowEnd = tileRowEnd * TILE_SIZE;
+
+    std::fill(m_depth.begin() + rowBegin * WIDTH, m_depth.begin() + rowEnd * WIDTH, 1.f);
+    for (const Triangle& triangle : m_triangles) {
+        rasterizeTriangle(triangle, rowBegin, rowEnd);
+    }
+
+    for (int tileY = tileRowBegin; tileY < tileRowEnd; tileY++) {
+        for (int tileX = 0; tileX < TILES_X; tileX++) {
+            float maxDepth = 0.f;
+            for (int y = tileY * TILE_SIZE; y < (tileY + 1) * TILE_SIZE; y++) {
+                const float* row = &m_depth[y * WIDTH + tileX * TILE_SIZE];
+                maxDepth = std::max(maxDepth, *std::max_element(row, row + TILE_SIZE));
+            }
+            m_tileMaxDepth[tileY * TILES_X + tileX] = maxDepth;
+        }
+    }
+}
+
+/**
+ * @brief edge function rasterization of one counter-clockwise triangle, sampled at pixel centers.
+ *      Depth is interpolated linearly in screen space (window z is affine there) and kept with min.
+ * @param rowBegin, rowEnd limit the rows written, [rowBegin, rowEnd)
+ */
+void SoftwareOcclusionCuller::rasterizeTriangle(const Triangle& triangle, int rowBegin, int rowEnd) {
+    const glm::vec3& a = triangle.v[0];
+    const glm::vec3& b = triangle.v[1];
+    const glm::vec3& c = triangle.v[2];
+
+    int minX = std::max(0, (int)std::floor(std::min({a.x, b.x, c.x})));
+    int maxX = std::min(WIDTH - 1, (int)std::ceil(std::max({a.x, b.x, c.x})));
+    int minY = std::max(rowBegin, (int)std::floor(std::min({a.y, b.y, c.y})));
+    int maxY = std::min(rowEnd - 1, (int)std::ceil(std::max({a.y, b.y, c.y})));
+    if (minX > maxX || minY > maxY) return;
+    // whole groups of 4 pixels; WIDTH is a multiple of 4 so the last group stays in the row
+    minX &= ~3;
+
+    // edge i runs from vertex i to vertex i + 1: e(x, y) = edgeA * x + edgeB * y + edgeC >= 0 inside
+    const glm::vec3* vertices[] = {&a, &b, &c};
+    float edgeA[3], edgeB[3], edgeC[3];
+    for (int edge = 0; edge < 3; edge++) {
+        const glm::vec3& from = *vertices[edge];
+        const glm::vec3& to = *vertices[(edge + 1) % 3];
+        edgeA[edge] = from.y - to.y;
+        edgeB[edge] = to.x - from.x;
+        edgeC[edge] = -(edgeA[edge] * from.x + edgeB[edge] * from.y);
+        // push the edge out by a thousandth of a pixel, so that rounding can not leave pixel
+        // centers lying exactly on an edge shared by two triangles uncovered by both
+        edgeC[edge] += EDGE_EPSILON * (std::abs(edgeA[edge]) + std::abs(edgeB[edge]));
+    }
+
+    // depth plane z(x, y) = a.z + dzdx * (x - a.x) + dzdy * (y - a.y)
+    float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+    float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+    float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+    float depthC = a.z - dzdx * a.x - dzdy * a.y;
+
+#ifdef SOFTWARE_OCCLUSION_SSE
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]);
+    __m128 depthDx = _mm_set1_ps(dzdx);
+
+    for (int y = minY; y <= maxY; y++) {
+        float centerY = y + 0.5f;
+        __m128 row0 = _mm_set1_ps(edgeB[0] * centerY + edgeC[0]);
+        __m128 row1 = _mm_set1_ps(edgeB[1] * centerY + edgeC[1]);
+        __m128 row2 = _mm_set1_ps(edgeB[2] * centerY + edgeC[2]);
+        __m128 rowDepth = _mm_set1_ps(dzdy * centerY + depthC);
+        float* depthRow = &m_depth[y * WIDTH];
+
+        for (int x = minX; x <= maxX; x += 4) {
+            __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, centerX), row0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, centerX), row1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, centerX), row2);
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+            if (_mm_movemask_ps(inside) == 0) continue;
+
+            __m128 depth = _mm_add_ps(_mm_mul_ps(depthDx, centerX), rowDepth);
+            __m128 previous = _mm_loadu_ps(depthRow + x);
+            __m128 nearest = _mm_min_ps(previous, depth);
+            _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++) {
+        float centerY = y + 0.5f;
+        float* depthRow = &m_depth[y * WIDTH];
+        for (int x = minX; x <= maxX; x++) {
+            float centerX = x + 0.5f;
+            bool inside = true;
+            for (int edge = 0; edge < 3; edge++) {
+                inside &= edgeA[edge] * centerX + edgeB[edge] * centerY + edgeC[edge] >= 0.f;
+            }
+            if (inside) {
+                depthRow[x] = std::min(depthRow[x], dzdx * centerX + dzdy * centerY + depthC);
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * @brief rasterize all bands: band 0 here, the others on the workers. Returns once all are done.
+ */
+void SoftwareOcclusionCuller::runBands() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation++;
+        m_busyWorkers = m_workers.size();
+    }
+    m_startCondition.notify_all();
+
+    rasterizeBand(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [&] { return m_busyWorkers == 0; });
+}
+
+void SoftwareOcclusionCuller::workerLoop(int band) {
+    int generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCondition.wait(lock, [&] { return m_quit || m_generation != generation; });
+            if (m_quit) return;
+            generation = m_generation;
+        }
+
+        rasterizeBand(band);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0) {
+            m_doneCondition.notify_one();
+        }
+    }
+}
+
+/**
+ * @brief project the box and compare its nearest depth with the buffer over its screen rectangle
+ *      (grown by a pixel to cover sub-pixel gaps between occluders). Tiles whose farthest depth is
+ *      in front of the box are accepted without reading their pixels.
+ */
+bool SoftwareOcclusionCuller::isOccluded(const AABB& worldBounds) const {
+    if (m_triangles.empty() || worldBounds.isEmpty()) {
+        return false;
+    }
+
+    glm::vec2 low(std::numeric_limits<float>::max());
+    glm::vec2 high(-std::numeric_limits<float>::max());
+    float nearestDepth = 1.f;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 point((corner & 1) ? worldBounds.max.x : worldBounds.min.x,
+                        (corner & 2) ? worldBounds.max.y : worldBounds.min.y,
+                        (corner & 4) ? worldBounds.max.z : worldBounds.min.z);
+        glm::vec4 clip = m_viewProj * glm::vec4(point, 1.f);
+        // boxes reaching the near plane are never culled
+        if (clip.w < MIN_CLIP_W || clip.z < -clip.w) {
+            return false;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT);
+        low = glm::min(low, screen);
+        high = glm::max(high, screen);
+        nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    int minX = std::max(0, (int)std::floor(low.x) - 1);
+    int maxX = std::min(WIDTH - 1, (int)std::ceil(high.x) + 1);
+    int minY = std::max(0, (int)std::floor(low.y) - 1);
+    int maxY = std::min(HEIGHT - 1, (int)std::ceil(high.y) + 1);
+    if (minX > maxX || minY > maxY) {
+        return false;
+    }
+
+    for (int tileY = minY / TILE_SIZE; tileY <= maxY / TILE_SIZE; tileY++) {
+        for (int tileX = minX / TILE_SIZE; tileX <= maxX / TILE_SIZE; tileX++) {
+            if (m_tileMaxDepth[tileY * TILES_X + tileX] < nearestDepth) continue;
+
+            int x0 = std::max(minX, tileX * TILE_SIZE);
+            int x1 = std::min(maxX, (tileX + 1) * TILE_SIZE - 1);
+            int y0 = std::max(minY, tileY * TILE_SIZE);
+            int y1 = std::min(maxY, (tileY + 1) * TILE_SIZE - 1);
+            for (int y = y0; y <= y1; y++) {
+                if (anyDepthAtLeast(&m_depth[y * WIDTH], x0, x1, nearestDepth)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int SoftwareOcclusionCuller::getOccluderCount() const {
+    return m_occluders.size();
+}
+
+int SoftwareOcclusionCuller::getOccluderTriangleCount() const {
+    return m_triangles.size();
+}
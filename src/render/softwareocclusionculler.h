@@ -0,0 +1,83 @@
+#ifndef SOFTWAREOCCLUSIONCULLER_H
+#define SOFTWAREOCCLUSIONCULLER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "render/instancebatcher.h"
+#include "utils/aabb.h"
+
+// CPU occlusion culling against a low resolution depth buffer, in the spirit of masked software
+// occlusion culling. Each frame the largest visible instances on screen are picked as occluders
+// and their triangles are rasterized (4 pixels at a time with SSE where available) into the depth
+// buffer; horizontal bands of the buffer are filled in parallel by worker threads. A max-depth
+// value per tile forms a one level hierarchy, so most occludee tests only read a few tiles.
+// No GPU readback is involved, so results are available before anything is submitted.
+class SoftwareOcclusionCuller
+{
+public:
+    static constexpr int WIDTH = 256;
+    static constexpr int HEIGHT = 128;
+    static constexpr int TILE_SIZE = 8;
+    static constexpr int TILES_X = WIDTH / TILE_SIZE;
+    static constexpr int TILES_Y = HEIGHT / TILE_SIZE;
+
+    // occluder budget per frame
+    static constexpr int MAX_OCCLUDERS = 24;
+    static constexpr int MAX_OCCLUDER_TRIANGLES = 4096;
+    static constexpr int MAX_TOTAL_TRIANGLES = 32768;
+
+    SoftwareOcclusionCuller();
+    ~SoftwareOcclusionCuller();
+
+    // Select occluders among the visible instances of the groups (after the camera frustum cull)
+    // and rasterize them with the camera's projection * view matrix.
+    void render(const std::vector<InstanceGroup>& groups, const glm::mat4& viewProj, const glm::vec3& cameraPos);
+
+    // true if the world-space box is hidden behind the occluders of the last render()
+    bool isOccluded(const AABB& worldBounds) const;
+
+    int getOccluderCount() const;
+    int getOccluderTriangleCount() const;
+
+private:
+    // screen-space triangle: x, y in buffer pixels, z is window depth in [0, 1]
+    struct Triangle {
+        glm::vec3 v[3];
+    };
+
+    void selectOccluders(const std::vector<InstanceGroup>& groups, const glm::vec3& cameraPos);
+    void setupTriangles(const std::vector<InstanceGroup>& groups);
+    void rasterizeBand(int band);
+    void rasterizeTriangle(const Triangle& triangle, int rowBegin, int rowEnd);
+    void runBands();
+    void workerLoop(int band);
+
+    glm::mat4 m_viewProj;
+
+    // (group, instance) of each occluder of the current frame
+    std::vector<std::pair<int, int>> m_occluders;
+    std::vector<Triangle> m_triangles;
+    std::vector<glm::vec4> m_clipPositions;
+
+    // row major, row 0 at the bottom of the screen. Cleared to 1 (far plane).
+    std::vector<float> m_depth;
+    // largest depth of each TILE_SIZE x TILE_SIZE tile
+    std::vector<float> m_tileMaxDepth;
+
+    // band 0 is rasterized by the calling thread, the others by m_workers
+    int m_numBands = 1;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_startCondition;
+    std::condition_variable m_doneCondition;
+    int m_generation = 0;
+    int m_busyWorkers = 0;
+    bool m_quit = false;
+};
+
+#endif // SOFTWAREOCCLUSIONCULLER_H
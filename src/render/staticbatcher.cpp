@@ -0,0 +1,232 @@
+#include "staticbatcher.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+namespace {
+
+// spread the low 10 bits of v out to every third bit
+uint32_t expandBits(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// 30-bit Morton code of a point inside bounds
+uint32_t mortonCode(const glm::vec3& point, const AABB& bounds) {
+    glm::vec3 extent = glm::max(bounds.extent(), glm::vec3(1e-6f));
+    glm::vec3 unit = glm::clamp((point - bounds.min) / extent, 0.f, 1.f);
+    glm::uvec3 cell = glm::uvec3(unit * 1023.f);
+    return (expandBits(cell.x) << 2) | (expandBits(cell.y) << 1) | expandBits(cell.z);
+}
+
+// a shape around merged data that is already final; updateVertexData does nothing
+Shape mergedShape(std::shared_ptr<std::vector<GLfloat>> vertexData, std::shared_ptr<std::vector<GLuint>> indexData) {
+    return Shape{
+        .getType = []() {
+            return PrimitiveType::PRIMITIVE_MESH;
+        },
+
+        .updateVertexData = [](int, int) {},
+
+        .getVertexData = [=]() {
+            return vertexData;
+        },
+
+        .getIndexData = [=]() {
+            return indexData;
+        }
+    };
+}
+
+/**
+ * @brief append the vertices of shape, moved to world space by instance, and its triangles.
+ */
+void appendTransformed(std::vector<GLfloat>& vertexData, std::vector<GLuint>& indexData,
+                       const Shape& shape, const InstanceData& instance) {
+    GLuint baseVertex = vertexData.size() / SOURCE_VERTEX_FLOATS;
+    const std::vector<GLfloat>& source = *shape.getVertexData();
+    glm::mat3 linear(instance.modelMatrix);
+
+    for (size_t i = 0; i + SOURCE_VERTEX_FLOATS <= source.size(); i += SOURCE_VERTEX_FLOATS) {
+        const GLfloat* v = &source[i];
+        glm::vec3 position = glm::vec3(instance.modelMatrix * glm::vec4(v[0], v[1], v[2], 1.f));
+        glm::vec3 normal = instance.normalMatrix * glm::vec3(v[3], v[4], v[5]);
+        glm::vec3 tangent = linear * glm::vec3(v[8], v[9], v[10]);
+        normal = glm::length(normal) > 0.f ? glm::normalize(normal) : normal;
+        tangent = glm::length(tangent) > 0.f ? glm::normalize(tangent) : tangent;
+
+        vertexData.insert(vertexData.end(), {
+            position.x, position.y, position.z,
+            normal.x, normal.y, normal.z,
+            v[6], v[7],
+            tangent.x, tangent.y, tangent.z
+        });
+    }
+
+    for (GLuint index : *shape.getIndexData()) {
+        indexData.push_back(baseVertex + index);
+    }
+}
+
+}
+
+/**
+ * @brief merge static shapes into world-space chunks and buffer them.
+ * @param context is made current for the openGL calls
+ * @param groups are the instance groups of the scene; their finest level of detail is merged
+ * @param firstVaoId is the first vaoId given to a chunk
+ */
+void StaticBatcher::build(GLContext* context, const std::vector<InstanceGroup>& groups, int firstVaoId) {
+    finish(context);
+
+    GLsizei stride = Shape().layout.getStride();
+    auto shapeBytes = [&](const Shape& shape) {
+        return shape.getVertexData()->size() / SOURCE_VERTEX_FLOATS * stride + shape.getIndexData()->size() * sizeof(GLushort);
+    };
+
+    // small shapes first: they cost the least memory per draw call saved
+    std::vector<int> order;
+    for (int groupIndex = 0; groupIndex < (int)groups.size(); groupIndex++) {
+        if ((int)(groups[groupIndex].shape->getVertexData()->size() / SOURCE_VERTEX_FLOATS) <= MAX_CHUNK_VERTICES) {
+            order.push_back(groupIndex);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return groups[a].shape->getVertexData()->size() < groups[b].shape->getVertexData()->size();
+    });
+
+    // (group, instance) pairs to merge, per material
+    std::map<int, std::vector<std::pair<int, int>>> materialInstances;
+    AABB sceneBounds;
+    for (int groupIndex : order) {
+        const InstanceGroup& group = groups[groupIndex];
+        size_t groupBytes = shapeBytes(*group.shape) * group.instances.size();
+        if (m_memoryUsage + groupBytes > MEMORY_BUDGET) {
+            continue;
+        }
+        m_memoryUsage += groupBytes;
+
+        for (int instance = 0; instance < (int)group.instances.size(); instance++) {
+            materialInstances[group.materialId].emplace_back(groupIndex, instance);
+            sceneBounds.expand(group.instanceBounds[instance]);
+        }
+    }
+
+    for (auto& [materialId, instances] : materialInstances) {
+        std::vector<uint32_t> codes(instances.size());
+        std::vector<int> sorted(instances.size());
+        for (int k = 0; k < (int)instances.size(); k++) {
+            auto [groupIndex, instance] = instances[k];
+            codes[k] = mortonCode(groups[groupIndex].instanceBounds[instance].center(), sceneBounds);
+            sorted[k] = k;
+        }
+        std::sort(sorted.begin(), sorted.end(), [&](int a, int b) { return codes[a] < codes[b]; });
+
+        const InstanceGroup& firstGroup = groups[instances.front().first];
+        std::shared_ptr<std::vector<GLfloat>> vertexData;
+        std::shared_ptr<std::vector<GLuint>> indexData;
+        for (int k : sorted) {
+            auto [groupIndex, instance] = instances[k];
+            const InstanceGroup& group = groups[groupIndex];
+            int shapeVertices = group.shape->getVertexData()->size() / SOURCE_VERTEX_FLOATS;
+
+            if (!vertexData || (int)(vertexData->size() / SOURCE_VERTEX_FLOATS) + shapeVertices > MAX_CHUNK_VERTICES) {
+                vertexData = std::make_shared<std::vector<GLfloat>>();
+                indexData = std::make_shared<std::vector<GLuint>>();
+                int vaoId = firstVaoId + m_chunks.size();
+                m_chunks.push_back(StaticChunk{mergedShape(vertexData, indexData), firstGroup.material,
+                                               materialId, firstGroup.textureSetId, vaoId, {}});
+            }
+            appendTransformed(*vertexData, *indexData, *group.shape, group.instances[instance]);
+            m_chunks.back().shapeIndices.push_back(group.shapeIndices[instance]);
+            m_batchedShapes.push_back(group.shapeIndices[instance]);
+        }
+    }
+
+    for (StaticChunk& chunk : m_chunks) {
+        chunk.shape.initGLObjects(context);
+        chunk.shape.bufferData(context);
+    }
+
+    std::cout << "static batching: " << m_batchedShapes.size() << " shapes in " << m_chunks.size() << " chunks, "
+              << m_memoryUsage / 1024 << " KiB" << std::endl;
+}
+
+void StaticBatcher::finish(GLContext* context) {
+    for (StaticChunk& chunk : m_chunks) {
+        chunk.shape.deleteGLObjects(context);
+    }
+    m_chunks.clear();
+    m_batchedShapes.clear();
+    m_visibleChunks.clear();
+    m_memoryUsage = 0;
+}
+
+const std::vector<StaticChunk>& StaticBatcher::getChunks() const {
+    return m_chunks;
+}
+
+const std::vector<int>& StaticBatcher::getBatchedShapes() const {
+    return m_batchedShapes;
+}
+
+size_t StaticBatcher::getMemoryUsage() const {
+    return m_memoryUsage;
+}
+
+/**
+ * @brief test the world bounds of every chunk against a frustum.
+ * @return number of visible and culled chunks
+ */
+CullStats StaticBatcher::cull(const Frustum& frustum) {
+    m_visibleChunks.clear();
+    for (int chunkIndex = 0; chunkIndex < (int)m_chunks.size(); chunkIndex++) {
+        if (frustum.intersects(m_chunks[chunkIndex].shape.bounds)) {
+            m_visibleChunks.push_back(chunkIndex);
+        }
+    }
+
+    CullStats stats;
+    stats.visible = m_visibleChunks.size();
+    stats.culled = m_chunks.size() - m_visibleChunks.size();
+    return stats;
+}
+
+CullStats StaticBatcher::cull(const std::vector<Frustum>& frusta) {
+    m_visibleChunks.clear();
+    for (int chunkIndex = 0; chunkIndex < (int)m_chunks.size(); chunkIndex++) {
+        const AABB& bounds = m_chunks[chunkIndex].shape.bounds;
+        if (std::any_of(frusta.begin(), frusta.end(), [&](const Frustum& frustum) { return frustum.intersects(bounds); })) {
+            m_visibleChunks.push_back(chunkIndex);
+        }
+    }
+
+    CullStats stats;
+    stats.visible = m_visibleChunks.size();
+    stats.culled = m_chunks.size() - m_visibleChunks.size();
+    return stats;
+}
+
+const std::vector<int>& StaticBatcher::getVisibleChunks() const {
+    return m_visibleChunks;
+}
+
+void StaticBatcher::bindIdentityTransforms() {
+    // model matrix columns
+    for (int column = 0; column < 4; column++) {
+        glm::vec4 identity(0.f);
+        identity[column] = 1.f;
+        glVertexAttrib4f(4 + column, identity.x, identity.y, identity.z, identity.w);
+    }
+    // normal matrix columns
+    for (int column = 0; column < 3; column++) {
+        glm::vec3 identity(0.f);
+        identity[column] = 1.f;
+        glVertexAttrib3f(8 + column, identity.x, identity.y, identity.z);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef STATICBATCHER_H
+#define STATICBATCHER_H
+
+#include <vector>
+
+#include "render/frustum.h"
+#include "render/instancebatcher.h"
+
+// Vertices of many static shapes with the same material, transformed to world space and merged
+// into one vbo. The chunk's Shape holds the merged data; its bounds are the chunk's world bounds.
+struct StaticChunk {
+    Shape shape;
+    SceneMaterial material;
+    // same ids as the instance groups the shapes came from, for render queue sort keys
+    int materialId;
+    int textureSetId;
+    // unique among the chunks and InstanceGroup::shapeId, for render queue sort keys
+    int vaoId;
+    // indices into RenderData::shapes of the merged shapes
+    std::vector<int> shapeIndices;
+};
+
+// Static batching: shapes that never move are pre-transformed into a few large world-space
+// buffers per material, so each pass draws them with a handful of non-instanced draw calls.
+// Chunk vaos have no instance arrays; bindIdentityTransforms() makes the instanced shaders read an
+// identity model / normal matrix for them instead.
+class StaticBatcher
+{
+public:
+    // vbo + ebo bytes all chunks together may use. Groups that do not fit stay instanced.
+    static constexpr size_t MEMORY_BUDGET = 64 << 20;
+    // vertices per chunk, so that every chunk can use 16-bit indices
+    static constexpr int MAX_CHUNK_VERTICES = 65536;
+
+    // Merge the groups whose shapes are cheap to duplicate, smallest shapes first, until the
+    // memory budget is spent. Shapes of a material are ordered along a Morton curve before they are
+    // cut into chunks, so every chunk covers a compact region of the scene.
+    // @param firstVaoId is the first vaoId to give out (one past the largest InstanceGroup::shapeId)
+    void build(GLContext* context, const std::vector<InstanceGroup>& groups, int firstVaoId);
+    // delete every chunk (also used to turn static batching off)
+    void finish(GLContext* context);
+
+    const std::vector<StaticChunk>& getChunks() const;
+    // indices into RenderData::shapes of every merged shape, to exclude them from instancing
+    const std::vector<int>& getBatchedShapes() const;
+    size_t getMemoryUsage() const;
+
+    // chunks whose bounds intersect the frustum, kept until the next cull
+    CullStats cull(const Frustum& frustum);
+    // chunks intersecting any of the frusta
+    CullStats cull(const std::vector<Frustum>& frusta);
+    const std::vector<int>& getVisibleChunks() const;
+
+    // set the current values of the instance attributes (4-10) to identity matrices. These are
+    // context state, not vao state, so call it once per pass before drawing chunks.
+    static void bindIdentityTransforms();
+
+private:
+    std::vector<StaticChunk> m_chunks;
+    std::vector<int> m_batchedShapes;
+    std::vector<int> m_visibleChunks;
+    size_t m_memoryUsage = 0;
+};
+
+#endif // STATICBATCHER_H
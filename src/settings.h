@@ -15,6 +15,15 @@ struct Settings {
     bool extraCredit2 = false;
     bool extraCredit3 = false;
     bool extraCredit4 = false;
+    int shadowCascades = 3;         // shadow maps per directional light
+    float cascadeSplitBlend = 0.75f; // 0 splits the view range uniformly, 1 logarithmically
+    int shadowFilterTaps = 8;       // depth comparisons per shadow lookup, each filtered 2x2
+    float shadowFilterRadius = 1.5f; // in shadow map texels
+    bool occlusionCulling = false;
+    bool softwareOcclusion = false;
+    bool staticBatching = false;
+    bool performanceOverlay = false;
+    int targetFrameRate = 0;        // frames per second, 0 follows the display refresh rate
 };
 
 
@@ -4,6 +4,7 @@ static const int MIN_PARAM1 = 1;
 
 Shape Cube() {
     auto vertexData = std::make_shared<std::vector<GLfloat>>();
+    auto indexData = std::make_shared<std::vector<GLuint>>();
     auto m_param1 = std::make_shared<int>(0);
 
     MakeTileSignature makeTile = [=](const glm::vec3& topLeft,
@@ -109,10 +110,16 @@ Shape Cube() {
 
             // left face (-y)
             makeFace(backTopLeft, frontTopLeft, backBottomLeft, frontBottomLeft);
+
+            indexVertexData(vertexData, indexData);
         },
 
         .getVertexData = [=]() {
             return vertexData;
+        },
+
+        .getIndexData = [=]() {
+            return indexData;
         }
     };
 }
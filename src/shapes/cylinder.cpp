@@ -5,6 +5,7 @@ static const int MIN_PARAM2 = 3;
 
 Shape Cylinder() {
     auto vertexData = std::make_shared<std::vector<GLfloat>>();
+    auto indexData = std::make_shared<std::vector<GLuint>>();
     auto m_param1 = std::make_shared<int>(0);
     auto m_param2 = std::make_shared<int>(0);
     float m_radius = 0.5f;
@@ -176,10 +177,16 @@ Shape Cylinder() {
 
                 makeWedge(currentTheta, nextTheta);
             }
+
+            indexVertexData(vertexData, indexData);
         },
 
         .getVertexData = [=]() {
             return vertexData;
+        },
+
+        .getIndexData = [=]() {
+            return indexData;
         }
     };
 }
@@ -1,9 +1,12 @@
 #include <iostream>
 #include "mesh.h"
+#include "utils/meshoptimizer.h"
+#include "utils/meshsimplifier.h"
 #include "utils/objfilereader.h"
 
 Shape Mesh(std::string meshfile) {
     auto vertexData = std::make_shared<std::vector<GLfloat>>();
+    auto indexData = std::make_shared<std::vector<GLuint>>();
     auto parsed = std::make_shared<bool>(false);
 
     return Shape{
@@ -13,8 +16,9 @@ Shape Mesh(std::string meshfile) {
 
         .updateVertexData = [=](int param1, int param2) {
             if (!*parsed) {
-                if (readAndParseFile(meshfile, vertexData)) {
+                if (readAndParseFile(meshfile, vertexData, indexData)) {
                     std::cout << "successfully parsed meshfile: " << meshfile << std::endl;
+                    MeshOptimizer::optimizeMesh(meshfile, vertexData, indexData);
                     *parsed = true;
                 } else {
                     std::cout << "failed to parse meshfile: " << meshfile << std::endl;
@@ -24,6 +28,45 @@ Shape Mesh(std::string meshfile) {
 
         .getVertexData = [=]() {
             return vertexData;
+        },
+
+        .getIndexData = [=]() {
+            return indexData;
+        }
+    };
+}
+
+Shape SimplifiedMesh(std::string name, const Shape& source, size_t targetTriangleCount) {
+    auto vertexData = std::make_shared<std::vector<GLfloat>>();
+    auto indexData = std::make_shared<std::vector<GLuint>>();
+    auto sourceVertexData = source.getVertexData();
+    auto sourceIndexData = source.getIndexData();
+    auto simplified = std::make_shared<bool>(false);
+
+    return Shape{
+        .getType = []() {
+            return PrimitiveType::PRIMITIVE_MESH;
+        },
+
+        .updateVertexData = [=](int param1, int param2) {
+            if (!*simplified) {
+                float error = 0.f;
+                *vertexData = *sourceVertexData;
+                *indexData = MeshSimplifier::simplify(*sourceVertexData, *sourceIndexData, targetTriangleCount, &error);
+                std::cout << "simplified mesh " << name << ": " << sourceIndexData->size() / 3 << " -> "
+                          << indexData->size() / 3 << " triangles, error " << error << std::endl;
+                // also drops the vertices the collapses left unreferenced
+                MeshOptimizer::optimizeMesh(name, vertexData, indexData);
+                *simplified = true;
+            }
+        },
+
+        .getVertexData = [=]() {
+            return vertexData;
+        },
+
+        .getIndexData = [=]() {
+            return indexData;
         }
     };
 }
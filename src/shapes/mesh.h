@@ -5,4 +5,8 @@
 
 Shape Mesh(std::string meshfile);
 
+// Coarser level of detail of a mesh: updateVertexData simplifies the source mesh's current vertex
+// data down to about targetTriangleCount triangles (see MeshSimplifier).
+Shape SimplifiedMesh(std::string name, const Shape& source, size_t targetTriangleCount);
+
 #endif // MESH_H
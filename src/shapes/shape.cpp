@@ -1,5 +1,9 @@
 #include "shape.h"
 
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
 // common function implementations needed between shapes
 
 /**
@@ -16,6 +20,118 @@ void insertVec2(std::shared_ptr<std::vector<float>> data, glm::vec2& v) {
     data->push_back(v.y);
 }
 
+namespace {
+
+// position, normal and uv of a vertex quantized so that corners which only differ by rounding
+// error in the generators are welded together
+struct WeldKey {
+    int32_t values[8];
+
+    bool operator==(const WeldKey& other) const {
+        return std::memcmp(values, other.values, sizeof(values)) == 0;
+    }
+};
+
+struct WeldKeyHash {
+    size_t operator()(const WeldKey& key) const {
+        size_t seed = 0;
+        for (int32_t value : key.values) {
+            seed ^= std::hash<int32_t>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+}
+
+/**
+ * @brief turn a triangle soup (11 floats per corner: pos, normal, uv, tangent) into unique vertices
+ *      and triangle indices. Corners are welded when their position, normal and uv match; the
+ *      per-triangle tangents of welded corners are averaged, which smooths them across the surface.
+ * @param vertexData holds the soup on input and the unique vertices on output
+ * @param indexData receives three indices per triangle
+ */
+void indexVertexData(std::shared_ptr<std::vector<GLfloat>> vertexData, std::shared_ptr<std::vector<GLuint>> indexData) {
+    const float weldScale = 1e5f;
+    std::vector<GLfloat> soup;
+    soup.swap(*vertexData);
+    indexData->clear();
+    indexData->reserve(soup.size() / SOURCE_VERTEX_FLOATS);
+
+    std::unordered_map<WeldKey, GLuint, WeldKeyHash> uniqueVertices;
+    uniqueVertices.reserve(soup.size() / SOURCE_VERTEX_FLOATS);
+
+    for (size_t corner = 0; corner + SOURCE_VERTEX_FLOATS <= soup.size(); corner += SOURCE_VERTEX_FLOATS) {
+        WeldKey key;
+        for (int i = 0; i < 8; i++) {
+            key.values[i] = static_cast<int32_t>(std::lround(soup[corner + i] * weldScale));
+        }
+
+        auto [it, inserted] = uniqueVertices.emplace(key, vertexData->size() / SOURCE_VERTEX_FLOATS);
+        if (inserted) {
+            vertexData->insert(vertexData->end(), soup.begin() + corner, soup.begin() + corner + SOURCE_VERTEX_FLOATS);
+        } else {
+            GLfloat* tangent = vertexData->data() + it->second * SOURCE_VERTEX_FLOATS + 8;
+            for (int i = 0; i < 3; i++) {
+                tangent[i] += soup[corner + 8 + i];
+            }
+        }
+        indexData->push_back(it->second);
+    }
+
+    for (size_t vertex = 0; vertex < vertexData->size(); vertex += SOURCE_VERTEX_FLOATS) {
+        GLfloat* tangent = vertexData->data() + vertex + 8;
+        glm::vec3 sum(tangent[0], tangent[1], tangent[2]);
+        // opposing tangents cancel out at uv seams and poles; any unit vector works there
+        // because the vertex shader re-orthogonalizes against the normal
+        glm::vec3 averaged = glm::length(sum) > 1e-6f ? glm::normalize(sum) : glm::vec3(1.f, 0.f, 0.f);
+        tangent[0] = averaged.x;
+        tangent[1] = averaged.y;
+        tangent[2] = averaged.z;
+    }
+}
+
+/**
+ * @brief Moller-Trumbore test of a ray against every triangle of the shape's cpu-side data.
+ *      The direction does not need to be normalized, so a world-space ray transformed by the
+ *      inverse model matrix reports the same t as in world space.
+ * @param t is the current closest hit and receives the new one
+ * @return true if a triangle closer than t was hit
+ */
+bool intersectRayShape(const Shape& shape, const glm::vec3& origin, const glm::vec3& direction, float& t) {
+    const std::vector<GLfloat>& vertexData = *shape.getVertexData();
+    const std::vector<GLuint>& indexData = *shape.getIndexData();
+    auto position = [&](GLuint vertex) {
+        return glm::vec3(vertexData[vertex * SOURCE_VERTEX_FLOATS], vertexData[vertex * SOURCE_VERTEX_FLOATS + 1], vertexData[vertex * SOURCE_VERTEX_FLOATS + 2]);
+    };
+
+    bool hit = false;
+    for (size_t i = 0; i + 2 < indexData.size(); i += 3) {
+        glm::vec3 p0 = position(indexData[i]);
+        glm::vec3 edge1 = position(indexData[i + 1]) - p0;
+        glm::vec3 edge2 = position(indexData[i + 2]) - p0;
+
+        glm::vec3 pvec = glm::cross(direction, edge2);
+        float det = glm::dot(edge1, pvec);
+        if (std::fabs(det) < 1e-12f) continue;
+        float invDet = 1.f / det;
+
+        glm::vec3 tvec = origin - p0;
+        float u = glm::dot(tvec, pvec) * invDet;
+        if (u < 0.f || u > 1.f) continue;
+        glm::vec3 qvec = glm::cross(tvec, edge1);
+        float v = glm::dot(direction, qvec) * invDet;
+        if (v < 0.f || u + v > 1.f) continue;
+
+        float tTriangle = glm::dot(edge2, qvec) * invDet;
+        if (tTriangle > 0.f && tTriangle < t) {
+            t = tTriangle;
+            hit = true;
+        }
+    }
+    return hit;
+}
+
 /**
  * @brief helper function to compute tangent vector, used for TBN matrix for texture.
  */
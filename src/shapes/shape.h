@@ -4,67 +4,97 @@
 #include <functional>
 #include <memory>
 #include <GL/glew.h>
-#include <QOpenGLWidget>
+#include "utils/glcontext.h"
 #include "utils/scenedata.h"
+#include "utils/aabb.h"
+#include "vertexlayout.h"
 
 using GetTypeSignature = auto()->PrimitiveType;
 // compute vertices using tessellation parameters
 using UpdateVertexDataSignature = auto(int param1, int param2)->void;
 using GetVertexDataSignature = auto()->std::shared_ptr<std::vector<GLfloat>>;
+// three indices into the vertex data per triangle
+using GetIndexDataSignature = auto()->std::shared_ptr<std::vector<GLuint>>;
 
 struct Shape {
     std::function<GetTypeSignature> getType;
     std::function<UpdateVertexDataSignature> updateVertexData;
     std::function<GetVertexDataSignature> getVertexData;
+    std::function<GetIndexDataSignature> getIndexData;
 
     GLuint vbo;
+    GLuint ebo;
     GLuint vao;
-    void initGLObjects(QOpenGLWidget* widget) {
-        widget->makeCurrent();
+    // how the vbo stores the generated vertices
+    VertexLayout layout = VertexLayout::compact(true);
+    // set by bufferData, used for glDrawElements
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    // dequantization of positions stored by the layout: pos = positionOffset + positionScale * stored
+    glm::vec3 positionOffset = glm::vec3(0.f);
+    glm::vec3 positionScale = glm::vec3(1.f);
+    // object space bounds of the vertex data, set by bufferData
+    AABB bounds;
+    void initGLObjects(GLContext* context) {
+        context->makeCurrent();
 
         glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
         glGenVertexArrays(1, &vao);
 
-        widget->doneCurrent();
+        context->doneCurrent();
     };
-    void bufferData(QOpenGLWidget* widget) {
-        widget->makeCurrent();
+    void bufferData(GLContext* context) {
+        context->makeCurrent();
+        glBindVertexArray(0);
 
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        std::vector<GLfloat> vertData = *getVertexData();
-        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertData.size(), vertData.data(), GL_STATIC_DRAW);
+        const std::vector<GLfloat>& vertData = *getVertexData();
+        bounds = AABB();
+        for (size_t i = 0; i + 2 < vertData.size(); i += SOURCE_VERTEX_FLOATS) {
+            bounds.expand(glm::vec3(vertData[i], vertData[i + 1], vertData[i + 2]));
+        }
+        std::vector<unsigned char> packedData = layout.pack(vertData, positionOffset, positionScale);
+        glBufferData(GL_ARRAY_BUFFER, packedData.size(), packedData.data(), GL_STATIC_DRAW);
+
+        // 16-bit indices whenever every vertex is addressable with them
+        const std::vector<GLuint>& indexData = *getIndexData();
+        indexCount = indexData.size();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        if (vertData.size() / SOURCE_VERTEX_FLOATS <= 65536) {
+            indexType = GL_UNSIGNED_SHORT;
+            std::vector<GLushort> shortIndices(indexData.begin(), indexData.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * shortIndices.size(), shortIndices.data(), GL_STATIC_DRAW);
+        } else {
+            indexType = GL_UNSIGNED_INT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indexData.size(), indexData.data(), GL_STATIC_DRAW);
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
         glBindVertexArray(vao);
-        // position
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GL_FLOAT),
-                              reinterpret_cast<void*>(0));
-        // normal
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GL_FLOAT),
-                              reinterpret_cast<void*>(3 * sizeof(GL_FLOAT)));
-
-        // uv
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), reinterpret_cast<void*>(6 * sizeof(GLfloat)));
-
-        // tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), reinterpret_cast<void*>(8 * sizeof(GLfloat)));
-
-        // unbind
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        bindVertexAttribs();
+
+        // unbind (vao first, so it keeps its element buffer)
         glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        widget->doneCurrent();
+        context->doneCurrent();
     };
-    void deleteGLObjects(QOpenGLWidget* widget) {
-        widget->makeCurrent();
+    // point attributes 0-3 (as described by layout) and the element buffer of the currently bound vao at this shape's buffers.
+    // Also used by vaos that combine the shape's vertices with other buffers (e.g. instance data).
+    void bindVertexAttribs() const {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        layout.bindAttribs();
+    };
+    void deleteGLObjects(GLContext* context) {
+        context->makeCurrent();
 
         glDeleteBuffers(1, &vbo);
+        glDeleteBuffers(1, &ebo);
         glDeleteVertexArrays(1, &vao);
 
-        widget->doneCurrent();
+        context->doneCurrent();
     };
 };
 
@@ -72,6 +102,12 @@ struct Shape {
 void insertVec3(std::shared_ptr<std::vector<GLfloat>> data, const glm::vec3& v);
 void insertVec2(std::shared_ptr<std::vector<float>> data, glm::vec2& v);
 
+// nearest hit of an object-space ray with the shape's triangles, closer than t. Updates t on a hit.
+bool intersectRayShape(const Shape& shape, const glm::vec3& origin, const glm::vec3& direction, float& t);
+
+// weld the triangle soup in vertexData in place and write the triangle indices into indexData
+void indexVertexData(std::shared_ptr<std::vector<GLfloat>> vertexData, std::shared_ptr<std::vector<GLuint>> indexData);
+
 glm::vec3 sphericalToCartesian(float phi, float theta);
 glm::vec3 cylindricalToCartesian(float r, float theta, float y);
 
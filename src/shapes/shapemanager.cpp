@@ -1,76 +1,139 @@
 #include "shapemanager.h"
 
+namespace {
+
+// tessellation parameters (param1, param2) of every level of detail, finest first.
+// A cube with one quad per face cannot get any coarser, so it has one level fewer.
+const int CONE_LOD_PARAMS[LodView::MAX_LEVELS][2] = {{4, 48}, {2, 24}, {1, 12}, {1, 6}};
+const int CUBE_LOD_PARAMS[LodView::MAX_LEVELS - 1][2] = {{4, 1}, {2, 1}, {1, 1}};
+const int SPHERE_LOD_PARAMS[LodView::MAX_LEVELS][2] = {{24, 48}, {12, 24}, {6, 12}, {3, 6}};
+const int CYLINDER_LOD_PARAMS[LodView::MAX_LEVELS][2] = {{4, 48}, {2, 24}, {1, 12}, {1, 6}};
+
+// triangle count of each simplified mesh level relative to the full mesh
+const float MESH_LOD_RATIOS[LodView::MAX_LEVELS - 1] = {0.5f, 0.25f, 0.125f};
+// a simplified level is only kept if it has at most this fraction of the previous level's triangles
+const float MIN_MESH_LOD_REDUCTION = 0.9f;
+// meshes are not simplified below this many triangles; tiny meshes are cheap and fold up quickly
+const size_t MIN_MESH_LOD_TRIANGLES = 64;
+
+}
+
 ShapeManager::ShapeManager() {}
 
 /**
- * @brief initialize the vbo and vao for each of the shape types.
- * @param widget allows access to makeCurrent for openGL context
+ * @brief tessellate every level of detail of each shape type and buffer it into its own vbo.
+ *      Tessellation is fixed from here on; which level a shape uses is decided per frame.
+ * @param context is made current for the openGL calls
  */
-void ShapeManager::init(QOpenGLWidget* widget) {
-    m_cone.initGLObjects(widget);
-    m_cube.initGLObjects(widget);
-    m_sphere.initGLObjects(widget);
-    m_cylinder.initGLObjects(widget);
-
-    m_initialized = true;
+void ShapeManager::init(GLContext* context) {
+    std::pair<PrimitiveLods*, const int (*)[2]> primitives[] = {
+        {&m_cone, CONE_LOD_PARAMS},
+        {&m_cube, CUBE_LOD_PARAMS},
+        {&m_sphere, SPHERE_LOD_PARAMS},
+        {&m_cylinder, CYLINDER_LOD_PARAMS},
+    };
+    for (auto [lods, params] : primitives) {
+        for (int lod = 0; lod < (int)lods->size(); lod++) {
+            Shape& shape = (*lods)[lod];
+            shape.updateVertexData(params[lod][0], params[lod][1]);
+            shape.initGLObjects(context);
+            shape.bufferData(context);
+        }
+    }
 }
 
 /**
- * @brief delete the vbo and vao for each of the shape types.
- * @param widget allows access to makeCurrent for openGL context
+ * @brief delete the vbo and vao for each of the shape types and every loaded mesh.
+ * @param context is made current for the openGL calls
  */
-void ShapeManager::finish(QOpenGLWidget* widget) {
-    m_cone.deleteGLObjects(widget);
-    m_cube.deleteGLObjects(widget);
-    m_sphere.deleteGLObjects(widget);
-    m_cylinder.deleteGLObjects(widget);
+void ShapeManager::finish(GLContext* context) {
+    for (PrimitiveLods* lods : {&m_cone, &m_cube, &m_sphere, &m_cylinder}) {
+        for (Shape& shape : *lods) {
+            shape.deleteGLObjects(context);
+        }
+    }
+    for (auto& [meshfile, lods] : meshMap) {
+        for (Shape& shape : lods) {
+            shape.deleteGLObjects(context);
+        }
+    }
+    meshMap.clear();
 }
 
 /**
- * @brief create and initialize unique mesh objects in the scene. buffer data into respectiev vbos.
+ * @brief create and initialize unique mesh objects in the scene, together with their simplified
+ *      levels of detail. buffer data into respective vbos.
+ *      The chain ends early when simplification stops making progress (e.g. on tiny or fully locked meshes).
  * @param shapes is a vector of RenderShapeData
  */
-void ShapeManager::parseMeshes(QOpenGLWidget *widget, const std::vector<RenderShapeData>& shapes) {
+void ShapeManager::parseMeshes(GLContext* context, const std::vector<RenderShapeData>& shapes) {
     for (const RenderShapeData& shapeData : shapes) {
-        if (shapeData.primitive.type == PrimitiveType::PRIMITIVE_MESH &&
-                !meshMap.contains(shapeData.primitive.meshfile)) {
-            // create new mesh and update its vertices. tessellation params ignored.
-            meshMap[shapeData.primitive.meshfile] = Mesh(shapeData.primitive.meshfile);
-            meshMap[shapeData.primitive.meshfile].updateVertexData(0, 0);
-            meshMap[shapeData.primitive.meshfile].initGLObjects(widget);
-            meshMap[shapeData.primitive.meshfile].bufferData(widget);
+        const std::string& meshfile = shapeData.primitive.meshfile;
+        if (shapeData.primitive.type != PrimitiveType::PRIMITIVE_MESH || meshMap.contains(meshfile)) {
+            continue;
+        }
+
+        // create new mesh and update its vertices. tessellation params ignored.
+        std::vector<Shape>& lods = meshMap[meshfile];
+        lods.push_back(Mesh(meshfile));
+        lods[0].updateVertexData(0, 0);
+        size_t triangleCount = lods[0].getIndexData()->size() / 3;
+
+        for (float ratio : MESH_LOD_RATIOS) {
+            size_t targetTriangles = size_t(triangleCount * ratio);
+            if (targetTriangles < MIN_MESH_LOD_TRIANGLES) {
+                break;
+            }
+            Shape lod = SimplifiedMesh(meshfile, lods.back(), targetTriangles);
+            lod.updateVertexData(0, 0);
+            size_t lodTriangles = lod.getIndexData()->size() / 3;
+            if (lodTriangles == 0 || lodTriangles > MIN_MESH_LOD_REDUCTION * (lods.back().getIndexData()->size() / 3)) {
+                break;
+            }
+            lods.push_back(lod);
+        }
+
+        for (Shape& lod : lods) {
+            lod.initGLObjects(context);
+            lod.bufferData(context);
         }
     }
 }
 
 /**
- * @brief for each shape type, update its vertices with the given tessellation parameters.
- *      If the vbo and vao have been initialized, buffer the new vertex data into the vbo.
- * @param widget allows access to makeCurrent for openGL context
- * @param param1 is the first shape tessellation parameter
- * @param param2 is the second shape tessellation parameter
+ * @brief given a RenderShapeData, switch on its primitive type in order to return the corresponding Shape object.
+ * @param shapeData of a shape in the scene being rendered.
+ * @return the finest level of detail of the shape
  */
-void ShapeManager::updateShapeVertices(QOpenGLWidget *widget, int param1, int param2) {
-    m_cone.updateVertexData(param1, param2);
-    m_cube.updateVertexData(param1, param2);
-    m_sphere.updateVertexData(param1, param2);
-    m_cylinder.updateVertexData(param1, param2);
-
-    if (m_initialized) {
-        m_cone.bufferData(widget);
-        m_cube.bufferData(widget);
-        m_sphere.bufferData(widget);
-        m_cylinder.bufferData(widget);
+const Shape& ShapeManager::getShape(const RenderShapeData& shapeData) {
+    return getShape(shapeData, 0);
+}
+
+int ShapeManager::getLodCount(const RenderShapeData& shapeData) {
+    if (shapeData.primitive.type != PrimitiveType::PRIMITIVE_MESH) {
+        return getPrimitiveLods(shapeData.primitive.type).size();
     }
+    auto it = meshMap.find(shapeData.primitive.meshfile);
+    return it != meshMap.end() ? it->second.size() : 0;
 }
 
 /**
- * @brief given a RenderShapeData, switch on its primitive type in order to return the corresponding Shape object.
- * @param shapeData of a shape in the scene being rendered.
- * @return the Shape object
+ * @param lod is the level of detail, 0 (finest) to getLodCount(shapeData) - 1
  */
-const Shape& ShapeManager::getShape(const RenderShapeData& shapeData) {
-    switch (shapeData.primitive.type) {
+const Shape& ShapeManager::getShape(const RenderShapeData& shapeData, int lod) {
+    if (shapeData.primitive.type != PrimitiveType::PRIMITIVE_MESH) {
+        return getPrimitiveLods(shapeData.primitive.type)[lod];
+    }
+
+    if (meshMap.count(shapeData.primitive.meshfile)) {
+        return meshMap[shapeData.primitive.meshfile][lod];
+    } else {
+        throw std::runtime_error("getShape: tried to get mesh that doesn't exist");
+    }
+}
+
+ShapeManager::PrimitiveLods& ShapeManager::getPrimitiveLods(PrimitiveType type) {
+    switch (type) {
     case PrimitiveType::PRIMITIVE_CONE:
         return m_cone;
     case PrimitiveType::PRIMITIVE_CUBE:
@@ -79,12 +142,8 @@ const Shape& ShapeManager::getShape(const RenderShapeData& shapeData) {
         return m_sphere;
     case PrimitiveType::PRIMITIVE_CYLINDER:
         return m_cylinder;
-    case PrimitiveType::PRIMITIVE_MESH:
-        if (meshMap.count(shapeData.primitive.meshfile)) {
-            return meshMap[shapeData.primitive.meshfile];
-        } else {
-            throw std::runtime_error("getShape: tried to get mesh that doesn't exist");
-        }
+    default:
+        throw std::runtime_error("getPrimitiveLods: meshes are not primitives");
     }
 }
 
@@ -98,7 +157,7 @@ GLuint ShapeManager::getVao(const RenderShapeData& shapeData) {
 }
 
 /**
- * @brief returns the size of the corresponding vbo so the glDrawArrays call can be made.
+ * @brief returns the size of the corresponding vbo.
  * @param shapeData of a shape in the scene being rendered.
  * @return the number of floats in the shape type's vbo.
  */
@@ -6,35 +6,44 @@
 #include "sphere.h"
 #include "cylinder.h"
 #include "mesh.h"
+#include "render/lodview.h"
 #include "utils/sceneparser.h"
 
+#include <vector>
+
 class ShapeManager
 {
 public:
     ShapeManager();
 
-    void init(QOpenGLWidget* widget);
-    void finish(QOpenGLWidget* widget);
-
-    void updateShapeVertices(QOpenGLWidget* widget, int param1, int param2);
+    void init(GLContext* context);
+    void finish(GLContext* context);
 
-    void parseMeshes(QOpenGLWidget *widget, const std::vector<RenderShapeData>& shapes);
+    void parseMeshes(GLContext* context, const std::vector<RenderShapeData>& shapes);
 
     GLuint getVao(const RenderShapeData& shapeData);
 
     int getVertexDataSize(const RenderShapeData& shapeData);
-private:
-    bool m_initialized = false;
-
-    Shape m_cone = Cone();
-    Shape m_cube = Cube();
-    Shape m_sphere = Sphere();
-    Shape m_cylinder = Cylinder();
 
+    // the finest level of detail of the shape
     const Shape& getShape(const RenderShapeData& shapeData);
-
-    // unordered map from meshfile to (Mesh) Shape objects
-    std::unordered_map<std::string, Shape> meshMap;
+    // levels of detail of the shape, finest first, up to LodView::MAX_LEVELS: fewer for cubes,
+    // which cannot get coarser, and for meshes whose simplification stops early.
+    int getLodCount(const RenderShapeData& shapeData);
+    const Shape& getShape(const RenderShapeData& shapeData, int lod);
+private:
+    using PrimitiveLods = std::vector<Shape>;
+    PrimitiveLods& getPrimitiveLods(PrimitiveType type);
+
+    // each level is tessellated once, see LOD_PARAMS in shapemanager.cpp
+    PrimitiveLods m_cone = {Cone(), Cone(), Cone(), Cone()};
+    PrimitiveLods m_cube = {Cube(), Cube(), Cube()};
+    PrimitiveLods m_sphere = {Sphere(), Sphere(), Sphere(), Sphere()};
+    PrimitiveLods m_cylinder = {Cylinder(), Cylinder(), Cylinder(), Cylinder()};
+
+    // unordered map from meshfile to its chain of levels of detail: the Mesh itself, followed by
+    // SimplifiedMesh levels at MESH_LOD_RATIOS of its triangle count
+    std::unordered_map<std::string, std::vector<Shape>> meshMap;
 };
 
 #endif // SHAPEMANAGER_H
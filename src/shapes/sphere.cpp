@@ -5,6 +5,7 @@ static const int MIN_PARAM2 = 3;
 
 Shape Sphere() {
     auto vertexData = std::make_shared<std::vector<GLfloat>>();
+    auto indexData = std::make_shared<std::vector<GLuint>>();
     auto m_param1 = std::make_shared<int>(0);
     auto m_param2 = std::make_shared<int>(0);
 
@@ -96,10 +97,16 @@ Shape Sphere() {
 
                 makeWedge(currentTheta, nextTheta);
             }
+
+            indexVertexData(vertexData, indexData);
         },
 
         .getVertexData = [=]() {
             return vertexData;
+        },
+
+        .getIndexData = [=]() {
+            return indexData;
         }
     };
 }
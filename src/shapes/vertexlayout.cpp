@@ -0,0 +1,148 @@
+#include "vertexlayout.h"
+
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+GLuint formatSize(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::FLOAT2:
+        return 2 * sizeof(GLfloat);
+    case VertexFormat::FLOAT3:
+        return 3 * sizeof(GLfloat);
+    case VertexFormat::HALF2:
+    case VertexFormat::SNORM_2_10_10_10:
+        return sizeof(GLuint);
+    case VertexFormat::SNORM16x4:
+        return 4 * sizeof(GLshort);
+    }
+    return 0;
+}
+
+}
+
+VertexLayout VertexLayout::standard() {
+    VertexLayout layout;
+    layout.addAttrib(0, VertexFormat::FLOAT3, 0);
+    layout.addAttrib(1, VertexFormat::FLOAT3, 3);
+    layout.addAttrib(2, VertexFormat::FLOAT2, 6);
+    layout.addAttrib(3, VertexFormat::FLOAT3, 8);
+    return layout;
+}
+
+VertexLayout VertexLayout::compact(bool quantizePositions) {
+    VertexLayout layout;
+    layout.addAttrib(0, quantizePositions ? VertexFormat::SNORM16x4 : VertexFormat::FLOAT3, 0);
+    layout.addAttrib(1, VertexFormat::SNORM_2_10_10_10, 3);
+    layout.addAttrib(2, VertexFormat::HALF2, 6);
+    layout.addAttrib(3, VertexFormat::SNORM_2_10_10_10, 8);
+    return layout;
+}
+
+/**
+ * @brief append an attribute to the packed vertex. Attributes are laid out in the order they are added.
+ * @param location of the attribute in the vertex shader
+ * @param format of the attribute in the vbo
+ * @param sourceOffset is the index of the attribute's first float in the 11-float source vertex
+ */
+void VertexLayout::addAttrib(GLuint location, VertexFormat format, int sourceOffset) {
+    m_attribs.push_back(VertexAttrib{location, format, sourceOffset, (GLuint)m_stride});
+    m_stride += formatSize(format);
+}
+
+GLsizei VertexLayout::getStride() const {
+    return m_stride;
+}
+
+void VertexLayout::bindAttribs() const {
+    for (const VertexAttrib& attrib : m_attribs) {
+        void* offset = reinterpret_cast<void*>((size_t)attrib.offset);
+        glEnableVertexAttribArray(attrib.location);
+
+        switch (attrib.format) {
+        case VertexFormat::FLOAT2:
+            glVertexAttribPointer(attrib.location, 2, GL_FLOAT, GL_FALSE, m_stride, offset);
+            break;
+        case VertexFormat::FLOAT3:
+            glVertexAttribPointer(attrib.location, 3, GL_FLOAT, GL_FALSE, m_stride, offset);
+            break;
+        case VertexFormat::HALF2:
+            glVertexAttribPointer(attrib.location, 2, GL_HALF_FLOAT, GL_FALSE, m_stride, offset);
+            break;
+        case VertexFormat::SNORM_2_10_10_10:
+            glVertexAttribPointer(attrib.location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, m_stride, offset);
+            break;
+        case VertexFormat::SNORM16x4:
+            glVertexAttribPointer(attrib.location, 4, GL_SHORT, GL_TRUE, m_stride, offset);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief convert 11-float source vertices into this layout.
+ * @param vertData is the source vertex data of a shape
+ * @param positionOffset receives the center of the quantization bounds
+ * @param positionScale receives the half extent of the quantization bounds
+ * @return the packed vbo contents, getStride() bytes per vertex
+ */
+std::vector<unsigned char> VertexLayout::pack(const std::vector<GLfloat>& vertData, glm::vec3& positionOffset, glm::vec3& positionScale) const {
+    size_t numVertices = vertData.size() / SOURCE_VERTEX_FLOATS;
+    std::vector<unsigned char> packed(numVertices * m_stride);
+
+    positionOffset = glm::vec3(0.f);
+    positionScale = glm::vec3(1.f);
+
+    for (const VertexAttrib& attrib : m_attribs) {
+        if (attrib.format != VertexFormat::SNORM16x4 || numVertices == 0) continue;
+
+        glm::vec3 minBound(vertData[attrib.sourceOffset], vertData[attrib.sourceOffset + 1], vertData[attrib.sourceOffset + 2]);
+        glm::vec3 maxBound = minBound;
+        for (size_t vertex = 0; vertex < numVertices; vertex++) {
+            const GLfloat* source = vertData.data() + vertex * SOURCE_VERTEX_FLOATS + attrib.sourceOffset;
+            minBound = glm::min(minBound, glm::vec3(source[0], source[1], source[2]));
+            maxBound = glm::max(maxBound, glm::vec3(source[0], source[1], source[2]));
+        }
+        positionOffset = (minBound + maxBound) * 0.5f;
+        // keep flat axes (e.g. a single quad) from dividing by zero
+        positionScale = glm::max((maxBound - minBound) * 0.5f, glm::vec3(1e-6f));
+    }
+
+    for (size_t vertex = 0; vertex < numVertices; vertex++) {
+        const GLfloat* source = vertData.data() + vertex * SOURCE_VERTEX_FLOATS;
+        unsigned char* dest = packed.data() + vertex * m_stride;
+
+        for (const VertexAttrib& attrib : m_attribs) {
+            const GLfloat* value = source + attrib.sourceOffset;
+            unsigned char* out = dest + attrib.offset;
+
+            switch (attrib.format) {
+            case VertexFormat::FLOAT2:
+                std::memcpy(out, value, 2 * sizeof(GLfloat));
+                break;
+            case VertexFormat::FLOAT3:
+                std::memcpy(out, value, 3 * sizeof(GLfloat));
+                break;
+            case VertexFormat::HALF2: {
+                GLuint half = glm::packHalf2x16(glm::vec2(value[0], value[1]));
+                std::memcpy(out, &half, sizeof(half));
+                break;
+            }
+            case VertexFormat::SNORM_2_10_10_10: {
+                GLuint packedVector = glm::packSnorm3x10_1x2(glm::vec4(value[0], value[1], value[2], 0.f));
+                std::memcpy(out, &packedVector, sizeof(packedVector));
+                break;
+            }
+            case VertexFormat::SNORM16x4: {
+                glm::vec3 normalized = (glm::vec3(value[0], value[1], value[2]) - positionOffset) / positionScale;
+                glm::uint64 packedPosition = glm::packSnorm4x16(glm::vec4(normalized, 0.f));
+                std::memcpy(out, &packedPosition, sizeof(packedPosition));
+                break;
+            }
+            }
+        }
+    }
+
+    return packed;
+}
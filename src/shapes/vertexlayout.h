@@ -0,0 +1,53 @@
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Shapes generate vertices on the CPU as 11 floats: position (0-2), normal (3-5), uv (6-7), tangent (8-10).
+// A VertexLayout decides how those floats are stored in the vbo and how the vao reads them back.
+static const int SOURCE_VERTEX_FLOATS = 11;
+
+enum class VertexFormat {
+    FLOAT2,             // 8 bytes
+    FLOAT3,             // 12 bytes
+    HALF2,              // 4 bytes
+    SNORM_2_10_10_10,   // 4 bytes, xyz of a unit vector (GL_INT_2_10_10_10_REV)
+    SNORM16x4           // 8 bytes, position quantized to the object bounds (see VertexLayout::pack)
+};
+
+struct VertexAttrib {
+    GLuint location;
+    VertexFormat format;
+    // first float of the attribute in the source vertex
+    int sourceOffset;
+    // byte offset in the packed vertex
+    GLuint offset;
+};
+
+class VertexLayout
+{
+public:
+    // the original 44-byte all-float layout
+    static VertexLayout standard();
+    // packed normals / tangents and half-float uvs (24 bytes), or 20 bytes with quantized positions
+    static VertexLayout compact(bool quantizePositions);
+
+    void addAttrib(GLuint location, VertexFormat format, int sourceOffset);
+    GLsizei getStride() const;
+
+    // enable and point every attribute at the currently bound GL_ARRAY_BUFFER
+    void bindAttribs() const;
+
+    // Converts source vertices into vbo contents. Quantized positions are stored relative to the
+    // bounds of the data; the shader reconstructs them as positionOffset + positionScale * stored.
+    // Layouts without quantized positions return offset 0 and scale 1.
+    std::vector<unsigned char> pack(const std::vector<GLfloat>& vertData, glm::vec3& positionOffset, glm::vec3& positionScale) const;
+
+private:
+    std::vector<VertexAttrib> m_attribs;
+    GLsizei m_stride = 0;
+};
+
+#endif // VERTEXLAYOUT_H
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+
+// Axis-aligned bounding box. A default constructed box is empty and grows with expand().
+struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    bool isEmpty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    glm::vec3 center() const {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 extent() const {
+        return max - min;
+    }
+
+    void expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const AABB& box) {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    // bounds of this box after an affine transform (Arvo's method, exact for the transformed corners)
+    AABB transformed(const glm::mat4& matrix) const {
+        if (isEmpty()) return *this;
+
+        AABB result;
+        result.min = result.max = glm::vec3(matrix[3]);
+        for (int column = 0; column < 3; column++) {
+            glm::vec3 a = glm::vec3(matrix[column]) * min[column];
+            glm::vec3 b = glm::vec3(matrix[column]) * max[column];
+            result.min += glm::min(a, b);
+            result.max += glm::max(a, b);
+        }
+        return result;
+    }
+};
@@ -0,0 +1,306 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const int SAH_BINS = 16;
+const int MAX_LEAF_SIZE = 4;
+// relative cost of one node traversal step versus one primitive test
+const float TRAVERSAL_COST = 1.f;
+
+float surfaceArea(const AABB& box) {
+    if (box.isEmpty()) return 0.f;
+    glm::vec3 e = box.extent();
+    return 2.f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+/**
+ * @brief slab test of a ray against a box.
+ * @return entry distance along the ray, or infinity if the box is missed or further than tMax
+ */
+float intersectRayBox(const AABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float tMax) {
+    glm::vec3 t0 = (box.min - origin) * inverseDirection;
+    glm::vec3 t1 = (box.max - origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+bool overlaps(const AABB& a, const AABB& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+}
+
+/**
+ * @brief build the tree from scratch.
+ * @param primitiveBounds holds one box per primitive; primitives are referred to by their index in it
+ */
+void BVH::build(const std::vector<AABB>& primitiveBounds) {
+    int primitiveCount = primitiveBounds.size();
+    m_primitiveBounds = primitiveBounds;
+    m_nodes.clear();
+    m_primitiveIndices.resize(primitiveCount);
+    if (primitiveCount == 0) {
+        return;
+    }
+
+    std::vector<glm::vec3> centroids(primitiveCount);
+    for (int i = 0; i < primitiveCount; i++) {
+        m_primitiveIndices[i] = i;
+        centroids[i] = primitiveBounds[i].center();
+    }
+
+    // a binary tree with n leaves has at most 2n - 1 nodes
+    m_nodes.reserve(2 * primitiveCount - 1);
+    m_nodes.push_back(Node{AABB(), 0, primitiveCount});
+    subdivide(0, primitiveBounds, centroids);
+    m_nodes.shrink_to_fit();
+}
+
+/**
+ * @brief compute a node's bounds and split it where the binned SAH cost is lowest, recursively.
+ *      Nodes stay leaves when no split is cheaper than testing all of their primitives.
+ */
+void BVH::subdivide(int nodeIndex, const std::vector<AABB>& primitiveBounds, const std::vector<glm::vec3>& centroids) {
+    int first = m_nodes[nodeIndex].leftFirst;
+    int count = m_nodes[nodeIndex].count;
+
+    AABB bounds;
+    AABB centroidBounds;
+    for (int i = first; i < first + count; i++) {
+        bounds.expand(primitiveBounds[m_primitiveIndices[i]]);
+        centroidBounds.expand(centroids[m_primitiveIndices[i]]);
+    }
+    m_nodes[nodeIndex].bounds = bounds;
+
+    if (count <= 1) {
+        return;
+    }
+
+    // evaluate SAH_BINS - 1 split planes on every axis
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    int bestSplit = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        float axisMin = centroidBounds.min[axis];
+        float axisExtent = centroidBounds.max[axis] - axisMin;
+        if (axisExtent <= 0.f) continue;
+
+        AABB binBounds[SAH_BINS];
+        int binCounts[SAH_BINS] = {};
+        float binScale = SAH_BINS / axisExtent;
+        for (int i = first; i < first + count; i++) {
+            int primitive = m_primitiveIndices[i];
+            int bin = std::min(SAH_BINS - 1, (int)((centroids[primitive][axis] - axisMin) * binScale));
+            binCounts[bin]++;
+            binBounds[bin].expand(primitiveBounds[primitive]);
+        }
+
+        // sweep from the right to get the area and count of every right side, then from the left
+        float rightAreas[SAH_BINS - 1];
+        int rightCounts[SAH_BINS - 1];
+        AABB rightBox;
+        int rightCount = 0;
+        for (int split = SAH_BINS - 1; split > 0; split--) {
+            rightBox.expand(binBounds[split]);
+            rightCount += binCounts[split];
+            rightAreas[split - 1] = surfaceArea(rightBox);
+            rightCounts[split - 1] = rightCount;
+        }
+        AABB leftBox;
+        int leftCount = 0;
+        for (int split = 0; split < SAH_BINS - 1; split++) {
+            leftBox.expand(binBounds[split]);
+            leftCount += binCounts[split];
+            if (leftCount == 0 || rightCounts[split] == 0) continue;
+
+            float cost = leftCount * surfaceArea(leftBox) + rightCounts[split] * rightAreas[split];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    float parentArea = surfaceArea(bounds);
+    float leafCost = count;
+    float splitCost = parentArea > 0.f ? TRAVERSAL_COST + bestCost / parentArea : leafCost;
+    if (bestAxis < 0 || (count <= MAX_LEAF_SIZE && splitCost >= leafCost)) {
+        return;
+    }
+
+    // partition the primitive indices around the chosen plane
+    float axisMin = centroidBounds.min[bestAxis];
+    float binScale = SAH_BINS / (centroidBounds.max[bestAxis] - axisMin);
+    int* middle = std::partition(m_primitiveIndices.data() + first, m_primitiveIndices.data() + first + count, [&](int primitive) {
+        int bin = std::min(SAH_BINS - 1, (int)((centroids[primitive][bestAxis] - axisMin) * binScale));
+        return bin <= bestSplit;
+    });
+    int leftCount = middle - (m_primitiveIndices.data() + first);
+
+    int leftChild = m_nodes.size();
+    m_nodes.push_back(Node{AABB(), first, leftCount});
+    m_nodes.push_back(Node{AABB(), first + leftCount, count - leftCount});
+    m_nodes[nodeIndex].leftFirst = leftChild;
+    m_nodes[nodeIndex].count = 0;
+
+    subdivide(leftChild, primitiveBounds, centroids);
+    subdivide(leftChild + 1, primitiveBounds, centroids);
+}
+
+/**
+ * @brief children always follow their parent in the array, so one reverse pass sees every
+ *      child before its parent.
+ */
+void BVH::refit(const std::vector<AABB>& primitiveBounds) {
+    m_primitiveBounds = primitiveBounds;
+    for (int nodeIndex = m_nodes.size() - 1; nodeIndex >= 0; nodeIndex--) {
+        Node& node = m_nodes[nodeIndex];
+        node.bounds = AABB();
+        if (node.isLeaf()) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                node.bounds.expand(primitiveBounds[m_primitiveIndices[i]]);
+            }
+        } else {
+            node.bounds.expand(m_nodes[node.leftFirst].bounds);
+            node.bounds.expand(m_nodes[node.leftFirst + 1].bounds);
+        }
+    }
+}
+
+void BVH::queryFrustum(const Frustum& frustum, std::vector<int>& result) const {
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    // (node, whether an ancestor was already fully inside)
+    std::vector<std::pair<int, bool>> stack{{0, false}};
+    while (!stack.empty()) {
+        auto [nodeIndex, inside] = stack.back();
+        stack.pop_back();
+        const Node& node = m_nodes[nodeIndex];
+
+        if (!inside) {
+            Frustum::Containment containment = frustum.classify(node.bounds);
+            if (containment == Frustum::Containment::OUTSIDE) continue;
+            inside = containment == Frustum::Containment::INSIDE;
+        }
+
+        if (node.isLeaf()) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                // a leaf that straddles the frustum still tests its primitives individually
+                if (inside || node.count == 1 || frustum.intersects(m_primitiveBounds[m_primitiveIndices[i]])) {
+                    result.push_back(m_primitiveIndices[i]);
+                }
+            }
+        } else {
+            stack.push_back({node.leftFirst + 1, inside});
+            stack.push_back({node.leftFirst, inside});
+        }
+    }
+}
+
+void BVH::queryBox(const AABB& box, std::vector<int>& result) const {
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    std::vector<int> stack{0};
+    while (!stack.empty()) {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!overlaps(node.bounds, box)) continue;
+
+        if (node.isLeaf()) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                if (overlaps(m_primitiveBounds[m_primitiveIndices[i]], box)) {
+                    result.push_back(m_primitiveIndices[i]);
+                }
+            }
+        } else {
+            stack.push_back(node.leftFirst + 1);
+            stack.push_back(node.leftFirst);
+        }
+    }
+}
+
+/**
+ * @param origin of the ray
+ * @param direction of the ray, need not be normalized (tHit is in units of its length)
+ * @param tHit receives the distance to the nearest hit
+ * @param test is an optional exact intersection test for a single primitive
+ */
+int BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float& tHit, const RayPrimitiveTest& test) const {
+    const float infinity = std::numeric_limits<float>::infinity();
+    tHit = infinity;
+    int hitPrimitive = -1;
+    if (m_nodes.empty()) {
+        return hitPrimitive;
+    }
+
+    glm::vec3 inverseDirection = 1.f / direction;
+    // (node, entry distance)
+    std::vector<std::pair<int, float>> stack;
+    float rootEntry = intersectRayBox(m_nodes[0].bounds, origin, inverseDirection, infinity);
+    if (rootEntry < infinity) {
+        stack.push_back({0, rootEntry});
+    }
+
+    while (!stack.empty()) {
+        auto [nodeIndex, entry] = stack.back();
+        stack.pop_back();
+        // a closer hit was found after this node was pushed
+        if (entry >= tHit) continue;
+        const Node& node = m_nodes[nodeIndex];
+
+        if (node.isLeaf()) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                int primitive = m_primitiveIndices[i];
+                float t = tHit;
+                if (test) {
+                    if (test(primitive, t) && t < tHit) {
+                        tHit = t;
+                        hitPrimitive = primitive;
+                    }
+                } else {
+                    t = intersectRayBox(m_primitiveBounds[primitive], origin, inverseDirection, tHit);
+                    if (t < tHit) {
+                        tHit = t;
+                        hitPrimitive = primitive;
+                    }
+                }
+            }
+            continue;
+        }
+
+        int nearChild = node.leftFirst;
+        int farChild = node.leftFirst + 1;
+        float nearEntry = intersectRayBox(m_nodes[nearChild].bounds, origin, inverseDirection, tHit);
+        float farEntry = intersectRayBox(m_nodes[farChild].bounds, origin, inverseDirection, tHit);
+        if (farEntry < nearEntry) {
+            std::swap(nearChild, farChild);
+            std::swap(nearEntry, farEntry);
+        }
+        // push the far child first so the near one is visited first
+        if (farEntry < infinity) stack.push_back({farChild, farEntry});
+        if (nearEntry < infinity) stack.push_back({nearChild, nearEntry});
+    }
+
+    return hitPrimitive;
+}
+
+const std::vector<BVH::Node>& BVH::getNodes() const {
+    return m_nodes;
+}
+
+int BVH::getPrimitiveCount() const {
+    return m_primitiveBounds.size();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "aabb.h"
+#include "render/frustum.h"
+
+// Bounding volume hierarchy over a list of primitive bounds (e.g. the world bounds of every
+// RenderShapeData). Built with a binned surface area heuristic and stored as a flat array in
+// depth-first order: a node's children are adjacent, and every child comes after its parent.
+class BVH
+{
+public:
+    // 32 bytes, two nodes per cache line
+    struct Node {
+        AABB bounds;
+        // leaf: index of the first entry in the primitive index list. Inner: index of the left child (right = left + 1).
+        int32_t leftFirst;
+        // number of primitives for leaves, 0 for inner nodes
+        int32_t count;
+
+        bool isLeaf() const {
+            return count > 0;
+        }
+    };
+
+    void build(const std::vector<AABB>& primitiveBounds);
+    // Recompute node bounds bottom-up after primitives moved, keeping the tree topology.
+    // Much cheaper than build(), but the tree quality degrades if primitives move far.
+    void refit(const std::vector<AABB>& primitiveBounds);
+
+    // Appends every primitive whose bounds may intersect the frustum. Subtrees that are fully
+    // inside are accepted without testing their children.
+    void queryFrustum(const Frustum& frustum, std::vector<int>& result) const;
+    // appends every primitive whose bounds overlap the box
+    void queryBox(const AABB& box, std::vector<int>& result) const;
+
+    // Exact test of one primitive. Returns true and sets t if the ray hits it closer than t.
+    using RayPrimitiveTest = std::function<bool(int primitive, float& t)>;
+
+    // Nearest primitive along the ray, or -1. Without a primitive test the primitive bounds are
+    // used as the hit shape. Children are visited near to far and pruned by the closest hit so far.
+    int raycast(const glm::vec3& origin, const glm::vec3& direction, float& tHit, const RayPrimitiveTest& test = nullptr) const;
+
+    const std::vector<Node>& getNodes() const;
+    int getPrimitiveCount() const;
+
+private:
+    void subdivide(int nodeIndex, const std::vector<AABB>& primitiveBounds, const std::vector<glm::vec3>& centroids);
+
+    std::vector<Node> m_nodes;
+    // leaves reference contiguous ranges of this list
+    std::vector<int> m_primitiveIndices;
+    std::vector<AABB> m_primitiveBounds;
+};
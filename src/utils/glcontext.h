@@ -0,0 +1,11 @@
+#pragma once
+
+// An OpenGL context that can be made current outside of rendering, e.g. while a scene is loaded.
+// Implemented by the widget's context in the application and by an offscreen context in the benchmark.
+class GLContext
+{
+public:
+    virtual ~GLContext() = default;
+    virtual void makeCurrent() = 0;
+    virtual void doneCurrent() = 0;
+};
@@ -0,0 +1,273 @@
+#include "meshoptimizer.h"
+#include "shapes/vertexlayout.h"
+
+#include <algorithm>
+#include <iostream>
+#include <glm/glm.hpp>
+
+namespace {
+
+glm::vec3 vertexPosition(const std::vector<GLfloat>& vertexData, GLuint vertex) {
+    const GLfloat* p = vertexData.data() + vertex * SOURCE_VERTEX_FLOATS;
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+}
+
+namespace MeshOptimizer {
+
+/**
+ * @brief simulate a FIFO post-transform vertex cache over the index buffer.
+ * @param indexData holds three indices per triangle
+ * @param vertexCount is the number of vertices in the vbo
+ * @param cacheSize is the number of vertices the simulated cache holds
+ */
+VertexCacheStats analyzeVertexCache(const std::vector<GLuint>& indexData, int vertexCount, int cacheSize) {
+    // time at which each vertex entered the cache; it is still cached while fewer than cacheSize misses followed
+    std::vector<long long> cachedAt(vertexCount, -1);
+    std::vector<bool> referenced(vertexCount, false);
+    long long misses = 0;
+    int referencedCount = 0;
+
+    for (GLuint vertex : indexData) {
+        if (cachedAt[vertex] < 0 || misses - cachedAt[vertex] >= cacheSize) {
+            cachedAt[vertex] = misses;
+            misses++;
+        }
+        if (!referenced[vertex]) {
+            referenced[vertex] = true;
+            referencedCount++;
+        }
+    }
+
+    int triangleCount = indexData.size() / 3;
+    return VertexCacheStats{
+        triangleCount > 0 ? (float)misses / triangleCount : 0.f,
+        referencedCount > 0 ? (float)misses / referencedCount : 0.f
+    };
+}
+
+/**
+ * @brief reorder triangles for post-transform cache locality by fanning around vertices that are
+ *      still in the cache, preferring ones that will stay there until their fan is done.
+ * @param indexData is reordered in place
+ * @param vertexCount is the number of vertices in the vbo
+ * @param cacheSize is the target cache size
+ * @return the first triangle of every cluster, starting with 0
+ */
+std::vector<int> optimizeVertexCache(std::vector<GLuint>& indexData, int vertexCount, int cacheSize) {
+    int triangleCount = indexData.size() / 3;
+    std::vector<int> clusters;
+    if (triangleCount == 0) {
+        return clusters;
+    }
+
+    // vertex -> triangles adjacency in compressed form
+    std::vector<int> liveTriangles(vertexCount, 0);
+    for (GLuint vertex : indexData) {
+        liveTriangles[vertex]++;
+    }
+    std::vector<int> adjacencyOffsets(vertexCount + 1, 0);
+    for (int vertex = 0; vertex < vertexCount; vertex++) {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+    }
+    std::vector<int> adjacency(indexData.size());
+    std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (int triangle = 0; triangle < triangleCount; triangle++) {
+        for (int corner = 0; corner < 3; corner++) {
+            adjacency[fill[indexData[triangle * 3 + corner]]++] = triangle;
+        }
+    }
+
+    std::vector<int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<int> deadEnds;
+    std::vector<int> candidates;
+    std::vector<GLuint> output;
+    output.reserve(indexData.size());
+
+    int time = cacheSize + 1;
+    int cursor = 0;
+    int fanVertex = 0;
+    bool startsCluster = true;
+
+    // returns the next vertex with live triangles when the cache has nothing useful left
+    auto skipDeadEnd = [&]() {
+        while (!deadEnds.empty()) {
+            int vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0) return vertex;
+        }
+        while (cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) return cursor;
+            cursor++;
+        }
+        return -1;
+    };
+
+    while (fanVertex >= 0) {
+        if (startsCluster && (clusters.empty() || clusters.back() != (int)output.size() / 3)) {
+            clusters.push_back(output.size() / 3);
+            startsCluster = false;
+        }
+
+        candidates.clear();
+        for (int a = adjacencyOffsets[fanVertex]; a < adjacencyOffsets[fanVertex + 1]; a++) {
+            int triangle = adjacency[a];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = true;
+
+            for (int corner = 0; corner < 3; corner++) {
+                GLuint vertex = indexData[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time;
+                    time++;
+                }
+            }
+        }
+
+        // pick the cached candidate that will still be cached once its remaining fan is emitted,
+        // preferring the oldest such vertex
+        int nextVertex = -1;
+        int bestPriority = -1;
+        for (int vertex : candidates) {
+            if (liveTriangles[vertex] <= 0) continue;
+            int priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                priority = time - cacheTime[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                nextVertex = vertex;
+            }
+        }
+        if (nextVertex < 0) {
+            nextVertex = skipDeadEnd();
+            startsCluster = true;
+        }
+        fanVertex = nextVertex;
+    }
+
+    indexData.swap(output);
+    return clusters;
+}
+
+/**
+ * @brief sort triangle clusters so that clusters facing away from the mesh center are drawn first.
+ *      Those tend to be in front from any viewpoint, so they fill the depth buffer early and the
+ *      fragments of the inner clusters fail the depth test. Triangle order inside a cluster (and
+ *      therefore most of the vertex cache locality) is preserved.
+ * @param indexData is reordered in place
+ * @param vertexData holds the positions the clusters are measured with
+ * @param clusters is the result of optimizeVertexCache on the same indexData
+ */
+void optimizeOverdraw(std::vector<GLuint>& indexData, const std::vector<GLfloat>& vertexData, const std::vector<int>& clusters) {
+    int triangleCount = indexData.size() / 3;
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    struct Cluster {
+        int begin, end;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float sortKey;
+    };
+    std::vector<Cluster> sortedClusters;
+
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        Cluster cluster{clusters[c], c + 1 < clusters.size() ? clusters[c + 1] : triangleCount, glm::vec3(0.f), glm::vec3(0.f), 0.f};
+
+        float clusterArea = 0.f;
+        for (int triangle = cluster.begin; triangle < cluster.end; triangle++) {
+            glm::vec3 p0 = vertexPosition(vertexData, indexData[triangle * 3]);
+            glm::vec3 p1 = vertexPosition(vertexData, indexData[triangle * 3 + 1]);
+            glm::vec3 p2 = vertexPosition(vertexData, indexData[triangle * 3 + 2]);
+            // twice the area weighted normal
+            glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(cross);
+
+            cluster.normal += cross;
+            cluster.centroid += (p0 + p1 + p2) / 3.f * area;
+            clusterArea += area;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += clusterArea;
+        if (clusterArea > 0.f) {
+            cluster.centroid /= clusterArea;
+        }
+        if (glm::length(cluster.normal) > 0.f) {
+            cluster.normal = glm::normalize(cluster.normal);
+        }
+        sortedClusters.push_back(cluster);
+    }
+    if (meshArea > 0.f) {
+        meshCentroid /= meshArea;
+    }
+
+    for (Cluster& cluster : sortedClusters) {
+        cluster.sortKey = glm::dot(cluster.centroid - meshCentroid, cluster.normal);
+    }
+    std::stable_sort(sortedClusters.begin(), sortedClusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<GLuint> output;
+    output.reserve(indexData.size());
+    for (const Cluster& cluster : sortedClusters) {
+        output.insert(output.end(), indexData.begin() + cluster.begin * 3, indexData.begin() + cluster.end * 3);
+    }
+    indexData.swap(output);
+}
+
+/**
+ * @brief renumber vertices in the order the index buffer first references them. Unreferenced
+ *      vertices are dropped.
+ * @param vertexData is reordered in place
+ * @param indexData is remapped in place
+ */
+void optimizeVertexFetch(std::vector<GLfloat>& vertexData, std::vector<GLuint>& indexData) {
+    const GLuint unmapped = ~GLuint(0);
+    std::vector<GLuint> remap(vertexData.size() / SOURCE_VERTEX_FLOATS, unmapped);
+    std::vector<GLfloat> output;
+    output.reserve(vertexData.size());
+
+    for (GLuint& vertex : indexData) {
+        if (remap[vertex] == unmapped) {
+            remap[vertex] = output.size() / SOURCE_VERTEX_FLOATS;
+            output.insert(output.end(), vertexData.begin() + vertex * SOURCE_VERTEX_FLOATS,
+                          vertexData.begin() + (vertex + 1) * SOURCE_VERTEX_FLOATS);
+        }
+        vertex = remap[vertex];
+    }
+    vertexData.swap(output);
+}
+
+/**
+ * @brief vertex cache, overdraw and vertex fetch optimization of a freshly loaded mesh.
+ * @param name identifies the mesh in the printed report
+ * @param vertexData holds 11 floats per vertex
+ * @param indexData holds three indices per triangle
+ */
+void optimizeMesh(const std::string& name, std::shared_ptr<std::vector<GLfloat>> vertexData, std::shared_ptr<std::vector<GLuint>> indexData) {
+    int vertexCount = vertexData->size() / SOURCE_VERTEX_FLOATS;
+    VertexCacheStats before = analyzeVertexCache(*indexData, vertexCount);
+
+    std::vector<int> clusters = optimizeVertexCache(*indexData, vertexCount);
+    optimizeOverdraw(*indexData, *vertexData, clusters);
+    optimizeVertexFetch(*vertexData, *indexData);
+
+    VertexCacheStats after = analyzeVertexCache(*indexData, vertexData->size() / SOURCE_VERTEX_FLOATS);
+    std::cout << "optimized mesh " << name << ": " << indexData->size() / 3 << " triangles in " << clusters.size()
+              << " clusters, ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+}
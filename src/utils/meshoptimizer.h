@@ -0,0 +1,37 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+// Triangle and vertex reordering for indexed meshes with 11-float vertices (see readAndParseFile).
+namespace MeshOptimizer {
+    // size of the simulated FIFO post-transform cache
+    const int CACHE_SIZE = 16;
+
+    struct VertexCacheStats {
+        // transformed vertices per triangle (0.5 is ideal for large regular meshes, 3 is the worst)
+        float acmr;
+        // transformed vertices per referenced vertex (1 is ideal)
+        float atvr;
+    };
+
+    VertexCacheStats analyzeVertexCache(const std::vector<GLuint>& indexData, int vertexCount, int cacheSize = CACHE_SIZE);
+
+    // Tipsify (Sander et al. 2007). Returns the start triangle of each cluster, i.e. every point
+    // where the fanning had to jump to a vertex outside the cache.
+    std::vector<int> optimizeVertexCache(std::vector<GLuint>& indexData, int vertexCount, int cacheSize = CACHE_SIZE);
+
+    // sort the clusters from optimizeVertexCache so that outward facing ones are drawn first
+    void optimizeOverdraw(std::vector<GLuint>& indexData, const std::vector<GLfloat>& vertexData, const std::vector<int>& clusters);
+
+    // renumber vertices in order of first use so that vertex fetches walk the vbo linearly
+    void optimizeVertexFetch(std::vector<GLfloat>& vertexData, std::vector<GLuint>& indexData);
+
+    // run all three stages in order and print the cache statistics before and after
+    void optimizeMesh(const std::string& name, std::shared_ptr<std::vector<GLfloat>> vertexData, std::shared_ptr<std::vector<GLuint>> indexData);
+}
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,485 @@
+#include "meshsimplifier.h"
+#include "shapes/vertexlayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+namespace {
+
+const GLuint NO_VERTEX = ~GLuint(0);
+
+// weight of the planes that hold border and seam edges in place, relative to the surface planes
+const float BOUNDARY_WEIGHT = 10.f;
+// a collapse may not turn the normal of any remaining triangle by more than ~75 degrees
+const float MIN_NORMAL_COS = 0.25f;
+// each pass only performs collapses up to the error of this fraction of its cheapest candidates,
+// so that cheap collapses made possible by the previous pass get their turn first
+const float PASS_ERROR_QUANTILE = 0.25f;
+
+enum class VertexKind : unsigned char {
+    MANIFOLD, // interior vertex with a single set of attributes
+    BORDER,   // on an open boundary of the surface
+    SEAM,     // interior, split into two vertices with different normals or uvs
+    LOCKED,   // corners of borders and seams, non-manifold vertices. Never moved.
+};
+
+// symmetric 4x4 quadric: error(p) = p^T A p + 2 b.p + c, summed over the accumulated planes
+struct Quadric {
+    float a00 = 0.f, a11 = 0.f, a22 = 0.f, a01 = 0.f, a02 = 0.f, a12 = 0.f;
+    float b0 = 0.f, b1 = 0.f, b2 = 0.f;
+    float c = 0.f;
+    // sum of the plane weights, turns the error into a mean squared distance
+    float weight = 0.f;
+
+    // plane normal.p + d = 0 with a unit normal
+    void addPlane(const glm::vec3& normal, float d, float weight) {
+        a00 += weight * normal.x * normal.x;
+        a11 += weight * normal.y * normal.y;
+        a22 += weight * normal.z * normal.z;
+        a01 += weight * normal.x * normal.y;
+        a02 += weight * normal.x * normal.z;
+        a12 += weight * normal.y * normal.z;
+        b0 += weight * normal.x * d;
+        b1 += weight * normal.y * d;
+        b2 += weight * normal.z * d;
+        c += weight * d * d;
+        this->weight += weight;
+    }
+
+    void add(const Quadric& other) {
+        a00 += other.a00; a11 += other.a11; a22 += other.a22;
+        a01 += other.a01; a02 += other.a02; a12 += other.a12;
+        b0 += other.b0; b1 += other.b1; b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+    }
+
+    float error(const glm::vec3& p) const {
+        float result = p.x * (a00 * p.x + 2.f * (a01 * p.y + a02 * p.z + b0))
+                     + p.y * (a11 * p.y + 2.f * (a12 * p.z + b1))
+                     + p.z * (a22 * p.z + 2.f * b2)
+                     + c;
+        return std::fabs(result);
+    }
+};
+
+// collapse of vertex `from` onto vertex `to`, both canonical (see buildPositionRemap)
+struct Collapse {
+    GLuint from;
+    GLuint to;
+    float cost;
+};
+
+uint64_t edgeKey(GLuint a, GLuint b) {
+    return (uint64_t(a) << 32) | b;
+}
+
+/**
+ * @brief find the vertices that only differ in their attributes.
+ * @param remap receives, for every vertex, the first vertex with the same position (its canonical vertex)
+ * @param wedges receives, for every vertex, the next vertex with the same position, forming a
+ *      circular list through all of them
+ */
+void buildPositionRemap(const std::vector<glm::vec3>& positions, std::vector<GLuint>& remap, std::vector<GLuint>& wedges) {
+    struct PositionHash {
+        size_t operator()(const glm::vec3& p) const {
+            uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+    std::unordered_map<glm::vec3, GLuint, PositionHash> firstVertex;
+    firstVertex.reserve(positions.size());
+
+    remap.resize(positions.size());
+    wedges.resize(positions.size());
+    for (GLuint vertex = 0; vertex < positions.size(); vertex++) {
+        auto [it, inserted] = firstVertex.emplace(positions[vertex], vertex);
+        remap[vertex] = it->second;
+        if (inserted) {
+            wedges[vertex] = vertex;
+        } else {
+            // splice in after the canonical vertex
+            wedges[vertex] = wedges[it->second];
+            wedges[it->second] = vertex;
+        }
+    }
+}
+
+// triangles around every vertex, in compressed rows
+struct Adjacency {
+    std::vector<GLuint> offsets;
+    std::vector<GLuint> triangles;
+
+    void build(const std::vector<GLuint>& indices, size_t vertexCount) {
+        offsets.assign(vertexCount + 1, 0);
+        for (GLuint vertex : indices) {
+            offsets[vertex + 1]++;
+        }
+        for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+            offsets[vertex + 1] += offsets[vertex];
+        }
+
+        triangles.resize(indices.size());
+        std::vector<GLuint> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t corner = 0; corner < indices.size(); corner++) {
+            triangles[fill[indices[corner]]++] = corner / 3;
+        }
+    }
+};
+
+/**
+ * @brief classify every vertex by the edges around it. An edge without a twin (the same edge in the
+ *      opposite direction) is a border edge; an edge whose positions have a twin but whose vertices
+ *      do not is a seam edge.
+ * @return the kind of each canonical vertex
+ */
+std::vector<VertexKind> classifyVertices(const std::vector<GLuint>& indices, const std::vector<GLuint>& remap,
+                                         const std::vector<GLuint>& wedges,
+                                         const std::unordered_map<uint64_t, int>& positionEdges,
+                                         const std::unordered_map<uint64_t, int>& vertexEdges) {
+    size_t vertexCount = remap.size();
+    std::vector<int> borderEdges(vertexCount, 0);
+    std::vector<int> seamEdges(vertexCount, 0);
+    std::vector<bool> nonManifold(vertexCount, false);
+    std::vector<bool> referenced(vertexCount, false);
+
+    for (size_t corner = 0; corner < indices.size(); corner++) {
+        GLuint a = indices[corner];
+        GLuint b = indices[corner - corner % 3 + (corner + 1) % 3];
+        GLuint ra = remap[a];
+        GLuint rb = remap[b];
+        referenced[a] = true;
+
+        if (positionEdges.at(edgeKey(ra, rb)) > 1) {
+            nonManifold[ra] = nonManifold[rb] = true;
+        }
+        if (!positionEdges.contains(edgeKey(rb, ra))) {
+            borderEdges[ra]++;
+            borderEdges[rb]++;
+        } else if (!vertexEdges.contains(edgeKey(b, a))) {
+            seamEdges[ra]++;
+            seamEdges[rb]++;
+        }
+    }
+
+    std::vector<VertexKind> kinds(vertexCount, VertexKind::LOCKED);
+    for (GLuint vertex = 0; vertex < vertexCount; vertex++) {
+        if (remap[vertex] != vertex || nonManifold[vertex]) {
+            continue;
+        }
+
+        int wedgeCount = 0;
+        GLuint wedge = vertex;
+        do {
+            wedgeCount += referenced[wedge];
+            wedge = wedges[wedge];
+        } while (wedge != vertex);
+
+        // a border vertex has one incoming and one outgoing border edge; a seam vertex has both sides
+        // of two seam edges
+        if (wedgeCount == 1 && borderEdges[vertex] == 0) {
+            kinds[vertex] = VertexKind::MANIFOLD;
+        } else if (wedgeCount == 1 && borderEdges[vertex] == 2) {
+            kinds[vertex] = VertexKind::BORDER;
+        } else if (wedgeCount == 2 && borderEdges[vertex] == 0 && seamEdges[vertex] == 4) {
+            kinds[vertex] = VertexKind::SEAM;
+        }
+    }
+    return kinds;
+}
+
+/**
+ * @brief sum the planes of the triangles around each vertex, weighted by triangle area. Border and
+ *      seam edges also add a plane through the edge, perpendicular to its triangle, which keeps
+ *      vertices from sliding off the border or seam.
+ */
+std::vector<Quadric> computeQuadrics(const std::vector<GLuint>& indices, const std::vector<GLuint>& remap,
+                                     const std::vector<glm::vec3>& positions,
+                                     const std::unordered_map<uint64_t, int>& positionEdges,
+                                     const std::unordered_map<uint64_t, int>& vertexEdges) {
+    std::vector<Quadric> quadrics(remap.size());
+
+    for (size_t triangle = 0; triangle < indices.size(); triangle += 3) {
+        GLuint r[3] = {remap[indices[triangle]], remap[indices[triangle + 1]], remap[indices[triangle + 2]]};
+        glm::vec3 cross = glm::cross(positions[r[1]] - positions[r[0]], positions[r[2]] - positions[r[0]]);
+        float doubleArea = glm::length(cross);
+        if (doubleArea == 0.f) {
+            continue;
+        }
+        glm::vec3 normal = cross / doubleArea;
+
+        Quadric plane;
+        plane.addPlane(normal, -glm::dot(normal, positions[r[0]]), 0.5f * doubleArea);
+        for (GLuint vertex : r) {
+            quadrics[vertex].add(plane);
+        }
+
+        for (int corner = 0; corner < 3; corner++) {
+            GLuint a = indices[triangle + corner];
+            GLuint b = indices[triangle + (corner + 1) % 3];
+            GLuint ra = r[corner];
+            GLuint rb = r[(corner + 1) % 3];
+            if (positionEdges.contains(edgeKey(rb, ra)) && vertexEdges.contains(edgeKey(b, a))) {
+                continue;
+            }
+
+            glm::vec3 edge = positions[rb] - positions[ra];
+            float length = glm::length(edge);
+            if (length == 0.f) {
+                continue;
+            }
+            glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+            Quadric edgePlane;
+            edgePlane.addPlane(edgeNormal, -glm::dot(edgeNormal, positions[ra]), BOUNDARY_WEIGHT * length * length);
+            quadrics[ra].add(edgePlane);
+            quadrics[rb].add(edgePlane);
+        }
+    }
+    return quadrics;
+}
+
+}
+
+namespace MeshSimplifier {
+
+/**
+ * @brief simplify the mesh in passes. Every pass rebuilds the connectivity, collects one candidate
+ *      collapse per edge (the cheaper valid direction) and performs them cheapest first. Vertices
+ *      around a collapse are not touched again in the same pass, so all candidate checks see
+ *      up to date triangles.
+ * @param vertexData holds 11 floats per vertex
+ * @param indexData holds three indices per triangle
+ * @param targetTriangleCount is the number of triangles to stop at
+ * @param resultError receives the largest collapse error, as the root mean squared distance of the
+ *      collapsed vertex to the planes of its quadric
+ */
+std::vector<GLuint> simplify(const std::vector<GLfloat>& vertexData, const std::vector<GLuint>& indexData,
+                             size_t targetTriangleCount, float* resultError) {
+    size_t vertexCount = vertexData.size() / SOURCE_VERTEX_FLOATS;
+    std::vector<GLuint> indices = indexData;
+
+    std::vector<glm::vec3> positions(vertexCount);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        const GLfloat* p = vertexData.data() + vertex * SOURCE_VERTEX_FLOATS;
+        positions[vertex] = glm::vec3(p[0], p[1], p[2]);
+    }
+
+    std::vector<GLuint> remap, wedges;
+    buildPositionRemap(positions, remap, wedges);
+
+    // directed edges of the current triangles, between canonical vertices and between vertices
+    std::unordered_map<uint64_t, int> positionEdges;
+    std::unordered_map<uint64_t, int> vertexEdges;
+    auto collectEdges = [&]() {
+        positionEdges.clear();
+        vertexEdges.clear();
+        for (size_t corner = 0; corner < indices.size(); corner++) {
+            GLuint a = indices[corner];
+            GLuint b = indices[corner - corner % 3 + (corner + 1) % 3];
+            positionEdges[edgeKey(remap[a], remap[b])]++;
+            vertexEdges[edgeKey(a, b)]++;
+        }
+    };
+
+    collectEdges();
+    std::vector<Quadric> quadrics = computeQuadrics(indices, remap, positions, positionEdges, vertexEdges);
+
+    Adjacency adjacency;
+    std::vector<Collapse> candidates;
+    std::vector<GLuint> collapseTo(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<std::pair<GLuint, GLuint>> wedgeTargets;
+    float maxError = 0.f;
+    bool firstPass = true;
+
+    // the vertex of `to` that each vertex of `from` moves to: the one sharing its triangles, so that
+    // the attributes on each side of a seam stay on that side
+    auto findWedgeTargets = [&](const Collapse& collapse) {
+        wedgeTargets.clear();
+        GLuint wedge = collapse.from;
+        do {
+            GLuint target = NO_VERTEX;
+            for (GLuint i = adjacency.offsets[wedge]; i < adjacency.offsets[wedge + 1]; i++) {
+                const GLuint* triangle = &indices[adjacency.triangles[i] * 3];
+                for (int corner = 0; corner < 3; corner++) {
+                    if (remap[triangle[corner]] != collapse.to) {
+                        continue;
+                    }
+                    if (target != NO_VERTEX && target != triangle[corner]) {
+                        return false;
+                    }
+                    target = triangle[corner];
+                }
+            }
+            if (adjacency.offsets[wedge] != adjacency.offsets[wedge + 1]) {
+                if (target == NO_VERTEX) {
+                    return false;
+                }
+                wedgeTargets.emplace_back(wedge, target);
+            }
+            wedge = wedges[wedge];
+        } while (wedge != collapse.from);
+        return true;
+    };
+
+    // @return the number of triangles the collapse removes, or -1 if it flips a remaining triangle
+    auto checkTriangles = [&](const Collapse& collapse) {
+        int removed = 0;
+        for (auto [wedge, target] : wedgeTargets) {
+            for (GLuint i = adjacency.offsets[wedge]; i < adjacency.offsets[wedge + 1]; i++) {
+                const GLuint* triangle = &indices[adjacency.triangles[i] * 3];
+                glm::vec3 before[3], after[3];
+                bool degenerate = false;
+                for (int corner = 0; corner < 3; corner++) {
+                    GLuint r = remap[triangle[corner]];
+                    degenerate |= r == collapse.to;
+                    before[corner] = positions[r];
+                    after[corner] = r == collapse.from ? positions[collapse.to] : before[corner];
+                }
+                if (degenerate) {
+                    removed++;
+                    continue;
+                }
+
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+                if (glm::dot(normalBefore, normalAfter) <= MIN_NORMAL_COS * lengths) {
+                    return -1;
+                }
+            }
+        }
+        return removed;
+    };
+
+    size_t triangleCount = indices.size() / 3;
+    while (triangleCount > targetTriangleCount) {
+        if (!firstPass) {
+            collectEdges();
+        }
+        firstPass = false;
+        std::vector<VertexKind> kinds = classifyVertices(indices, remap, wedges, positionEdges, vertexEdges);
+        adjacency.build(indices, vertexCount);
+
+        // one candidate per edge, from the half edge with the smaller canonical vertex first (or the
+        // only half edge of a border)
+        candidates.clear();
+        for (size_t corner = 0; corner < indices.size(); corner++) {
+            GLuint a = indices[corner];
+            GLuint b = indices[corner - corner % 3 + (corner + 1) % 3];
+            GLuint ra = remap[a];
+            GLuint rb = remap[b];
+            bool border = !positionEdges.contains(edgeKey(rb, ra));
+            if (ra == rb || (ra > rb && !border)) {
+                continue;
+            }
+            bool seam = !border && !vertexEdges.contains(edgeKey(b, a));
+
+            auto canMove = [&](GLuint vertex) {
+                switch (kinds[vertex]) {
+                case VertexKind::MANIFOLD:
+                    return true;
+                case VertexKind::BORDER:
+                    return border;
+                case VertexKind::SEAM:
+                    return seam;
+                default:
+                    return false;
+                }
+            };
+
+            Collapse best = {NO_VERTEX, NO_VERTEX, 0.f};
+            for (auto [from, to] : {std::make_pair(ra, rb), std::make_pair(rb, ra)}) {
+                if (!canMove(from)) {
+                    continue;
+                }
+                float cost = quadrics[from].error(positions[to]) + quadrics[to].error(positions[to]);
+                if (best.from == NO_VERTEX || cost < best.cost) {
+                    best = {from, to, cost};
+                }
+            }
+            if (best.from != NO_VERTEX) {
+                candidates.push_back(best);
+            }
+        }
+        if (candidates.empty()) {
+            break;
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) {
+            return a.cost < b.cost;
+        });
+        float passErrorLimit = candidates[size_t((candidates.size() - 1) * PASS_ERROR_QUANTILE)].cost;
+
+        for (GLuint vertex = 0; vertex < vertexCount; vertex++) {
+            collapseTo[vertex] = vertex;
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t removedTriangles = 0;
+        bool collapsedAny = false;
+        for (const Collapse& collapse : candidates) {
+            if (triangleCount - removedTriangles <= targetTriangleCount) {
+                break;
+            }
+            if (collapse.cost > passErrorLimit && collapsedAny) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] || !findWedgeTargets(collapse)) {
+                continue;
+            }
+            int removed = checkTriangles(collapse);
+            if (removed < 0) {
+                continue;
+            }
+
+            for (auto [wedge, target] : wedgeTargets) {
+                collapseTo[wedge] = target;
+                for (GLuint i = adjacency.offsets[wedge]; i < adjacency.offsets[wedge + 1]; i++) {
+                    const GLuint* triangle = &indices[adjacency.triangles[i] * 3];
+                    for (int corner = 0; corner < 3; corner++) {
+                        touched[remap[triangle[corner]]] = true;
+                    }
+                }
+            }
+            float weight = quadrics[collapse.from].weight + quadrics[collapse.to].weight;
+            if (weight > 0.f) {
+                maxError = std::max(maxError, collapse.cost / weight);
+            }
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            removedTriangles += removed;
+            collapsedAny = true;
+        }
+        if (!collapsedAny) {
+            break;
+        }
+
+        // apply the collapses and drop the triangles that lost an edge
+        size_t kept = 0;
+        for (size_t triangle = 0; triangle < indices.size(); triangle += 3) {
+            GLuint a = collapseTo[indices[triangle]];
+            GLuint b = collapseTo[indices[triangle + 1]];
+            GLuint c = collapseTo[indices[triangle + 2]];
+            if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a]) {
+                continue;
+            }
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+        triangleCount = kept / 3;
+    }
+
+    if (resultError) {
+        *resultError = std::sqrt(maxError);
+    }
+    return indices;
+}
+
+}
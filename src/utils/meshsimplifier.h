@@ -0,0 +1,21 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <vector>
+#include <GL/glew.h>
+
+// Quadric error metric simplification (Garland and Heckbert 1997) of indexed meshes with 11-float
+// vertices (see readAndParseFile). Edges are collapsed onto one of their two vertices, so the
+// simplified triangles reference the original vertices and keep their normals, uvs and tangents.
+// Vertices on open borders only slide along the border, vertices on uv or normal seams only along
+// the seam, and vertices where several of these meet never move.
+namespace MeshSimplifier {
+    // Collapse edges in order of increasing error until at most targetTriangleCount triangles are
+    // left, or no collapse is possible without breaking a border, seam or triangle orientation.
+    // @param resultError receives the largest collapse error as a distance in object space
+    // @return three indices per triangle into the unchanged vertexData
+    std::vector<GLuint> simplify(const std::vector<GLfloat>& vertexData, const std::vector<GLuint>& indexData,
+                                 size_t targetTriangleCount, float* resultError = nullptr);
+}
+
+#endif // MESHSIMPLIFIER_H
@@ -1,17 +1,52 @@
 #include "objfilereader.h"
+#include "shapes/shape.h"
 #include <glm/glm.hpp>
 #include <qdir.h>
 #include <unordered_map>
 #include <iostream>
 
+namespace {
+
+// a face corner as written in the obj file. uv and normal are -1 when the file omits them.
+struct ObjCorner {
+    int v, vt, vn;
+
+    bool operator==(const ObjCorner& other) const {
+        return v == other.v && vt == other.vt && vn == other.vn;
+    }
+};
+
+struct ObjCornerHash {
+    size_t operator()(const ObjCorner& corner) const {
+        return std::hash<long long>()(((long long)corner.v * 73856093) ^ ((long long)corner.vt * 19349663) ^ ((long long)corner.vn * 83492791));
+    }
+};
+
+/**
+ * @brief parse one obj index (1-based, or negative relative to the end of the list).
+ * @return a 0-based index, or -1 if the field is empty or invalid
+ */
+int parseObjIndex(const QString& field, int listSize) {
+    bool ok = false;
+    int index = field.toInt(&ok);
+    if (!ok || index == 0) {
+        return -1;
+    }
+    index = index > 0 ? index - 1 : listSize + index;
+    return index >= 0 && index < listSize ? index : -1;
+}
+
+}
+
 /**
- * @brief push a vertex and a normal into vertexData in vbo format
- *      (pos x, pos y, pos z, normal x, normal y, normal z)
+ * @brief push a vertex into vertexData in vbo format
+ *      (pos x, pos y, pos z, normal x, normal y, normal z, u, v, tangent x, tangent y, tangent z)
  * @param vertData is a Mesh's vertex data to push into
  * @param vertex is a position in object space
  * @param normal is a normal in object space
+ * @param uv is a texture coordinate
  */
-void pushVertexData(std::shared_ptr<std::vector<GLfloat>> vertData, const glm::vec3& vertex, const glm::vec3& normal) {
+void pushVertexData(std::shared_ptr<std::vector<GLfloat>> vertData, const glm::vec3& vertex, const glm::vec3& normal, const glm::vec2& uv) {
     vertData->push_back(vertex.x);
     vertData->push_back(vertex.y);
     vertData->push_back(vertex.z);
@@ -19,6 +54,14 @@ void pushVertexData(std::shared_ptr<std::vector<GLfloat>> vertData, const glm::v
     vertData->push_back(normal.x);
     vertData->push_back(normal.y);
     vertData->push_back(normal.z);
+
+    vertData->push_back(uv.x);
+    vertData->push_back(uv.y);
+
+    // tangent is accumulated once all faces are known
+    vertData->push_back(0.f);
+    vertData->push_back(0.f);
+    vertData->push_back(0.f);
 }
 
 /**
@@ -42,23 +85,43 @@ void parse3Floats(QString line, std::vector<glm::vec3>& dest) {
 }
 
 /**
- * @brief read in a meshfile and parse vertex data into the given vector pointer.
- * @param vertData, pointer to a vector in which to place the vertex data.
- *      vertData consists of interweaved vertices (vec3) and normals (vec3).
+ * @brief parse 2 floats from the given line. push them as a vec2 into the dest vector.
+ * @param line is a trimmed line from the obj file
+ * @param dest is the destination vector which holds vec2's of parsed floats
+ */
+void parse2Floats(QString line, std::vector<glm::vec2>& dest) {
+    QStringList stringList = line.split(' ', Qt::SkipEmptyParts);
+    bool ok_u, ok_v;
+    ok_u = ok_v = false;
+    float u = stringList.at(1).toFloat(&ok_u);
+    float v = stringList.size() > 2 ? stringList.at(2).toFloat(&ok_v) : (ok_v = true, 0.f);
+    if (ok_u && ok_v) {
+        dest.push_back(glm::vec2{u, v});
+    } else {
+        std::cout << "error parsing float from line: " << line.toStdString() << std::endl;
+    }
+}
+
+/**
+ * @brief read in a meshfile and parse it into indexed vertex data.
+ *      Face corners with the same v/vt/vn triple are welded into one vertex.
+ * @param vertData, pointer to a vector in which to place the unique vertices (11 floats each).
+ * @param indexData, pointer to a vector in which to place three vertex indices per triangle.
  * @return 1 for success, 0 for failure
  */
-int readAndParseFile(std::string meshfile, std::shared_ptr<std::vector<GLfloat>> vertData) {
+int readAndParseFile(std::string meshfile, std::shared_ptr<std::vector<GLfloat>> vertData, std::shared_ptr<std::vector<GLuint>> indexData) {
     vertData->clear();
-
-    bool meshfileIncludesNormals = true;
+    indexData->clear();
 
     std::vector<glm::vec3> vertices;
     std::vector<glm::vec3> vertexNormals;
+    std::vector<glm::vec2> texCoords;
 
-    // maps vertex index (in vbo) to object index
+    // maps a v/vt/vn triple to its index in vertData
+    std::unordered_map<ObjCorner, GLuint, ObjCornerHash> cornerMap;
+    // obj position index of every vertex in vertData, for the vertices that need computed normals
     std::vector<int> objIndices;
-    // map 1-index of vertex (int) to normals of faces that neighbor vertex
-    std::unordered_map<int, std::vector<glm::vec3>> faceNormalMap;
+    bool anyMissingNormals = false;
 
     QFile file(meshfile.c_str());
     if (!file.open(QFile::ReadOnly)) {
@@ -66,6 +129,19 @@ int readAndParseFile(std::string meshfile, std::shared_ptr<std::vector<GLfloat>>
         return 0;
     }
 
+    // returns the vertData index for a face corner, adding the vertex the first time it is seen
+    auto getVertexIndex = [&](const ObjCorner& corner) {
+        auto [it, inserted] = cornerMap.emplace(corner, vertData->size() / SOURCE_VERTEX_FLOATS);
+        if (inserted) {
+            glm::vec3 normal = corner.vn >= 0 ? vertexNormals[corner.vn] : glm::vec3{0, 0, 0};
+            glm::vec2 uv = corner.vt >= 0 ? texCoords[corner.vt] : glm::vec2{0, 0};
+            pushVertexData(vertData, vertices[corner.v], normal, uv);
+            objIndices.push_back(corner.v);
+            anyMissingNormals |= corner.vn < 0;
+        }
+        return it->second;
+    };
+
     /*
      * parse through file line by line
      * if doesn't include vertex normals, must compute them ourselves
@@ -80,94 +156,88 @@ int readAndParseFile(std::string meshfile, std::shared_ptr<std::vector<GLfloat>>
             parse3Floats(line, vertices);
         } else if (stringList.at(0) == "vn") {
             parse3Floats(line, vertexNormals);
+        } else if (stringList.at(0) == "vt") {
+            parse2Floats(line, texCoords);
         } else if (stringList.at(0) == "f") {
-            // if we encounter an 'f' line before seeing any normals, the meshfile does not include vertex normals
-            if (vertexNormals.size() == 0) {
-                meshfileIncludesNormals = false;
+            // parse every corner of the face: v, v/vt, v//vn or v/vt/vn
+            std::vector<ObjCorner> corners;
+            for (int coord = 1; coord < stringList.size(); coord++) {
+                QStringList coordList = stringList.at(coord).split("/");
+                ObjCorner corner{parseObjIndex(coordList.at(0), vertices.size()), -1, -1};
+                if (coordList.size() > 1) corner.vt = parseObjIndex(coordList.at(1), texCoords.size());
+                if (coordList.size() > 2) corner.vn = parseObjIndex(coordList.at(2), vertexNormals.size());
+
+                if (corner.v < 0) {
+                    std::cout << "error parsing int from line: " << line.toStdString() << std::endl;
+                    corners.clear();
+                    break;
+                }
+                corners.push_back(corner);
             }
-            // number of coordinates in the face line. could be 4, 5, ... . 4 implies f and 3 coordinates.
-            int numCoords = stringList.size();
 
             // for more than 3 coordinates per face line, construct triangles from 123, 134, ...
-            QStringList coord1List = stringList.at(1).split("/");
-            QStringList coord2List;
-            QStringList coord3List;
-            for (int coord2 = 2; coord2 <= numCoords - 2; coord2++) {
-                coord2List = stringList.at(coord2).split("/");
-                coord3List = stringList.at(coord2 + 1).split("/");
-
-                bool ok_v1i, ok_v2i, ok_v3i, ok_n1i, ok_n2i, ok_n3i;
-                ok_v1i = ok_v2i = ok_v3i = ok_n1i = ok_n2i = ok_n3i = false;
-                int v1i, v2i, v3i, n1i, n2i, n3i;
-                // parse vertex indices
-                v1i = coord1List.at(0).toInt(&ok_v1i);
-                v2i = coord2List.at(0).toInt(&ok_v2i);
-                v3i = coord3List.at(0).toInt(&ok_v3i);
-
-                if (meshfileIncludesNormals) {
-                    // parse vertex normal indices
-                    n1i = coord1List.at(2).toInt(&ok_n1i);
-                    n2i = coord2List.at(2).toInt(&ok_n2i);
-                    n3i = coord3List.at(2).toInt(&ok_n3i);
-                    if (ok_v1i && ok_v2i && ok_v3i && ok_n1i && ok_n2i && ok_n3i) {
-                        pushVertexData(vertData, vertices[v1i - 1], vertexNormals[n1i - 1]);
-                        pushVertexData(vertData, vertices[v2i - 1], vertexNormals[n2i - 1]);
-                        pushVertexData(vertData, vertices[v3i - 1], vertexNormals[n3i - 1]);
-                    } else {
-                        std::cout << "error parsing int from line: " << line.toStdString() << std::endl;
-                    }
-                } else {
-                    if (ok_v1i && ok_v2i && ok_v3i) {
-                        // set normals to zero for now, compute them later
-                        pushVertexData(vertData, vertices[v1i - 1], glm::vec3{0,0,0});
-                        pushVertexData(vertData, vertices[v2i - 1], glm::vec3{0,0,0});
-                        pushVertexData(vertData, vertices[v3i - 1], glm::vec3{0,0,0});
-                        objIndices.push_back(v1i);
-                        objIndices.push_back(v2i);
-                        objIndices.push_back(v3i);
-
-                        if (!meshfileIncludesNormals) {
-                            if (!faceNormalMap.contains(v1i)) {
-                                faceNormalMap[v1i] = std::vector<glm::vec3>();
-                            }
-                            if (!faceNormalMap.contains(v2i)) {
-                                faceNormalMap[v2i] = std::vector<glm::vec3>();
-                            }
-                            if (!faceNormalMap.contains(v3i)) {
-                                faceNormalMap[v3i] = std::vector<glm::vec3>();
-                            }
-
-                            // compute face normal via cross product of vertices at given indices
-                            glm::vec3 cross = glm::cross(vertices[v2i - 1] - vertices[v1i - 1], vertices[v3i - 1] - vertices[v1i - 1]);
-                            // store face normal (unnormalized) in faceNormalMap
-                            faceNormalMap[v1i].push_back(cross);
-                            faceNormalMap[v2i].push_back(cross);
-                            faceNormalMap[v3i].push_back(cross);
-                        }
-                    } else {
-                        std::cout << "error parsing int from line: " << line.toStdString() << std::endl;
-                    }
-                }
+            for (int coord2 = 1; coord2 + 1 < (int)corners.size(); coord2++) {
+                indexData->push_back(getVertexIndex(corners[0]));
+                indexData->push_back(getVertexIndex(corners[coord2]));
+                indexData->push_back(getVertexIndex(corners[coord2 + 1]));
             }
         }
         // ignore lines with any other headers (e.g. #)
     }
 
-    if (!meshfileIncludesNormals) {
-        // compute vertex normals for each vertex using the neighboring faces
-        for (int vertIndex = 1; vertIndex <= vertData->size() / 6; vertIndex++) {
-            int objIndex = objIndices[vertIndex - 1];
-            glm::vec3 vertexNormal{0};
-            for (glm::vec3 faceNormal : faceNormalMap[objIndex]) {
-                vertexNormal += faceNormal;
+    int numVertices = vertData->size() / SOURCE_VERTEX_FLOATS;
+    auto position = [&](GLuint vertIndex) {
+        const GLfloat* vertex = vertData->data() + vertIndex * SOURCE_VERTEX_FLOATS;
+        return glm::vec3(vertex[0], vertex[1], vertex[2]);
+    };
+    auto uv = [&](GLuint vertIndex) {
+        const GLfloat* vertex = vertData->data() + vertIndex * SOURCE_VERTEX_FLOATS;
+        return glm::vec2(vertex[6], vertex[7]);
+    };
+
+    // sum of the (area weighted) normals of the faces around each obj position
+    std::vector<glm::vec3> faceNormalSums;
+    if (anyMissingNormals) {
+        faceNormalSums.assign(vertices.size(), glm::vec3{0});
+    }
+
+    for (size_t i = 0; i + 2 < indexData->size(); i += 3) {
+        GLuint i0 = (*indexData)[i], i1 = (*indexData)[i + 1], i2 = (*indexData)[i + 2];
+        glm::vec3 p0 = position(i0), p1 = position(i1), p2 = position(i2);
+
+        if (anyMissingNormals) {
+            glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            faceNormalSums[objIndices[i0]] += cross;
+            faceNormalSums[objIndices[i1]] += cross;
+            faceNormalSums[objIndices[i2]] += cross;
+        }
+
+        glm::vec3 tangent = computeTangent(p0, p1, p2, uv(i0), uv(i1), uv(i2));
+        for (GLuint vertIndex : {i0, i1, i2}) {
+            for (int c = 0; c < 3; c++) {
+                (*vertData)[vertIndex * SOURCE_VERTEX_FLOATS + 8 + c] += tangent[c];
             }
-            vertexNormal = glm::normalize(vertexNormal);
-            // replace placeholder zeros in vertData with vertex normals
-            (*vertData)[(vertIndex - 1) * 6 + 3] = vertexNormal.x;
-            (*vertData)[(vertIndex - 1) * 6 + 4] = vertexNormal.y;
-            (*vertData)[(vertIndex - 1) * 6 + 5] = vertexNormal.z;
         }
     }
 
+    for (int vertIndex = 0; vertIndex < numVertices; vertIndex++) {
+        GLfloat* vertex = vertData->data() + vertIndex * SOURCE_VERTEX_FLOATS;
+
+        // replace placeholder zero normals with the normalized neighboring face normals
+        if (anyMissingNormals && vertex[3] == 0.f && vertex[4] == 0.f && vertex[5] == 0.f) {
+            glm::vec3 vertexNormal = faceNormalSums[objIndices[vertIndex]];
+            vertexNormal = glm::length(vertexNormal) > 0.f ? glm::normalize(vertexNormal) : glm::vec3{0, 1, 0};
+            vertex[3] = vertexNormal.x;
+            vertex[4] = vertexNormal.y;
+            vertex[5] = vertexNormal.z;
+        }
+
+        glm::vec3 tangent(vertex[8], vertex[9], vertex[10]);
+        tangent = glm::length(tangent) > 1e-6f ? glm::normalize(tangent) : glm::vec3{1, 0, 0};
+        vertex[8] = tangent.x;
+        vertex[9] = tangent.y;
+        vertex[10] = tangent.z;
+    }
+
     return 1;
 }
@@ -3,8 +3,10 @@
 
 #include <memory>
 #include <vector>
+#include <string>
 #include <GL/glew.h>
 
-int readAndParseFile(std::string meshfile, std::shared_ptr<std::vector<GLfloat>> vertData);
+// vertData receives unique vertices (pos, normal, uv, tangent) and indexData three indices per triangle
+int readAndParseFile(std::string meshfile, std::shared_ptr<std::vector<GLfloat>> vertData, std::shared_ptr<std::vector<GLuint>> indexData);
 
 #endif // OBJFILEREADER_H
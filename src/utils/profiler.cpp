@@ -0,0 +1,260 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// nearest-rank percentile of sorted samples
+float percentile(const std::vector<float>& sorted, float p) {
+    int rank = std::clamp((int)std::ceil(p * sorted.size()) - 1, 0, (int)sorted.size() - 1);
+    return sorted[rank];
+}
+
+}
+
+void Profiler::init() {
+    m_gpuTiming = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    m_frame = 0;
+    m_droppedGpuFrames = 0;
+}
+
+void Profiler::finish() {
+    for (GpuFrame& gpuFrame : m_gpuFrames) {
+        if (!gpuFrame.queries.empty()) {
+            glDeleteQueries(gpuFrame.queries.size(), gpuFrame.queries.data());
+        }
+        gpuFrame = GpuFrame();
+    }
+    m_gpuStack.clear();
+    closeCsv();
+}
+
+/**
+ * @brief start a frame. The queries of the frame NUM_BUFFERED_FRAMES back are read and their
+ *      slot reused for this frame.
+ */
+void Profiler::beginFrame() {
+    m_frame++;
+    GpuFrame& gpuFrame = m_gpuFrames[m_frame % NUM_BUFFERED_FRAMES];
+    collectGpuFrame(gpuFrame);
+    gpuFrame.used = 0;
+    gpuFrame.frame = m_frame;
+    m_gpuStack.clear();
+}
+
+/**
+ * @brief record the CPU sections timed during the frame.
+ */
+void Profiler::endFrame() {
+    for (Section& section : m_sections) {
+        if (!section.gpu && section.timed) {
+            addSample(section, section.frameTime, m_frame);
+        }
+    }
+}
+
+int Profiler::beginCpu(const std::string& name) {
+    int index = getSection(name, false);
+    m_sections[index].start = Clock::now();
+    return index;
+}
+
+void Profiler::endCpu(int section) {
+    Section& s = m_sections[section];
+    s.frameTime += std::chrono::duration<float, std::milli>(Clock::now() - s.start).count();
+    s.timed = true;
+}
+
+void Profiler::beginGpu(const std::string& name) {
+    if (!m_gpuTiming) {
+        return;
+    }
+
+    GpuFrame& gpuFrame = m_gpuFrames[m_frame % NUM_BUFFERED_FRAMES];
+    if (2 * gpuFrame.used + 2 > (int)gpuFrame.queries.size()) {
+        GLuint queries[2];
+        glGenQueries(2, queries);
+        gpuFrame.queries.insert(gpuFrame.queries.end(), queries, queries + 2);
+        gpuFrame.sections.push_back(-1);
+    }
+    int pair = gpuFrame.used++;
+    gpuFrame.sections[pair] = getSection(name, true);
+    gpuFrame.lastQuery = gpuFrame.queries[2 * pair];
+    glQueryCounter(gpuFrame.lastQuery, GL_TIMESTAMP);
+    m_gpuStack.push_back(pair);
+}
+
+void Profiler::endGpu() {
+    if (!m_gpuTiming || m_gpuStack.empty()) {
+        return;
+    }
+
+    GpuFrame& gpuFrame = m_gpuFrames[m_frame % NUM_BUFFERED_FRAMES];
+    gpuFrame.lastQuery = gpuFrame.queries[2 * m_gpuStack.back() + 1];
+    glQueryCounter(gpuFrame.lastQuery, GL_TIMESTAMP);
+    m_gpuStack.pop_back();
+}
+
+/**
+ * @brief read the timestamps of a completed frame. Queries are processed in order, so once the
+ *      one issued last is available all of them are. Sections nest, so that is not necessarily
+ *      the end of the last pair begun (the outer frame section ends after its inner ones). If it
+ *      is not available, the samples are dropped rather than waited for.
+ */
+void Profiler::collectGpuFrame(GpuFrame& gpuFrame) {
+    if (gpuFrame.used == 0) {
+        return;
+    }
+
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(gpuFrame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        m_droppedGpuFrames++;
+        return;
+    }
+
+    for (int pair = 0; pair < gpuFrame.used; pair++) {
+        GLuint64 begin, end;
+        glGetQueryObjectui64v(gpuFrame.queries[2 * pair], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(gpuFrame.queries[2 * pair + 1], GL_QUERY_RESULT, &end);
+        Section& section = m_sections[gpuFrame.sections[pair]];
+        section.frameTime += end > begin ? (end - begin) * 1e-6f : 0.f;
+        section.timed = true;
+    }
+    for (Section& section : m_sections) {
+        if (section.gpu && section.timed) {
+            addSample(section, section.frameTime, gpuFrame.frame);
+        }
+    }
+}
+
+int Profiler::getSection(const std::string& name, bool gpu) {
+    std::unordered_map<std::string, int>& indices = m_sectionIndices[gpu ? 1 : 0];
+    auto found = indices.find(name);
+    if (found != indices.end()) {
+        return found->second;
+    }
+
+    Section section;
+    section.name = name;
+    section.gpu = gpu;
+    section.window.reserve(WINDOW_SIZE);
+    m_sections.push_back(section);
+    indices.emplace(name, m_sections.size() - 1);
+    return m_sections.size() - 1;
+}
+
+void Profiler::addSample(Section& section, float milliseconds, int frame) {
+    if ((int)section.window.size() < WINDOW_SIZE) {
+        section.window.push_back(milliseconds);
+    } else {
+        section.window[section.next] = milliseconds;
+    }
+    section.next = (section.next + 1) % WINDOW_SIZE;
+    section.frameTime = 0.f;
+    section.timed = false;
+
+    if (m_csv.is_open()) {
+        m_csv << frame << ',' << section.name << ',' << (section.gpu ? "gpu" : "cpu") << ',' << milliseconds << '\n';
+    }
+}
+
+bool Profiler::openCsv(const std::string& filePath) {
+    closeCsv();
+    m_csv.open(filePath);
+    if (!m_csv.is_open()) {
+        return false;
+    }
+    m_csv << "frame,section,type,milliseconds\n";
+    return true;
+}
+
+void Profiler::closeCsv() {
+    if (m_csv.is_open()) {
+        m_csv.close();
+    }
+}
+
+bool Profiler::isWritingCsv() const {
+    return m_csv.is_open();
+}
+
+std::vector<TimingSummary> Profiler::summarize() const {
+    std::vector<TimingSummary> summaries;
+    for (const Section& section : m_sections) {
+        if (section.window.empty()) continue;
+
+        // the window is a ring; rotate it so the last sample comes last
+        std::vector<float> samples(section.window.begin() + section.next % section.window.size(), section.window.end());
+        samples.insert(samples.end(), section.window.begin(), section.window.begin() + section.next % section.window.size());
+
+        TimingSummary summary = summarizeSamples(samples);
+        summary.name = section.name;
+        summary.gpu = section.gpu;
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
+
+TimingSummary Profiler::summarizeSamples(const std::vector<float>& samples) {
+    TimingSummary summary{"", false, (int)samples.size(), 0.f, 0.f, 0.f, 0.f, 0.f};
+    if (samples.empty()) {
+        return summary;
+    }
+    summary.last = samples.back();
+
+    std::vector<float> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (float sample : sorted) {
+        sum += sample;
+    }
+    summary.average = sum / sorted.size();
+    summary.p50 = percentile(sorted, 0.50f);
+    summary.p95 = percentile(sorted, 0.95f);
+    summary.p99 = percentile(sorted, 0.99f);
+    return summary;
+}
+
+std::string Profiler::formatSummary() const {
+    std::string text;
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-20s %7s %7s %7s %7s\n", "ms", "avg", "p50", "p95", "p99");
+    text += line;
+    for (const TimingSummary& summary : summarize()) {
+        std::string name = (summary.gpu ? "gpu " : "cpu ") + summary.name;
+        std::snprintf(line, sizeof(line), "%-20.20s %7.2f %7.2f %7.2f %7.2f\n", name.c_str(),
+                      summary.average, summary.p50, summary.p95, summary.p99);
+        text += line;
+    }
+    if (m_droppedGpuFrames > 0) {
+        std::snprintf(line, sizeof(line), "%d frames of GPU timings dropped\n", m_droppedGpuFrames);
+        text += line;
+    }
+    return text;
+}
+
+int Profiler::getDroppedGpuFrames() const {
+    return m_droppedGpuFrames;
+}
+
+float Profiler::getLastSample(const std::string& name, bool gpu) const {
+    const std::unordered_map<std::string, int>& indices = m_sectionIndices[gpu ? 1 : 0];
+    auto found = indices.find(name);
+    if (found == indices.end() || m_sections[found->second].window.empty()) {
+        return 0.f;
+    }
+    const Section& section = m_sections[found->second];
+    return section.window[(section.next + WINDOW_SIZE - 1) % WINDOW_SIZE];
+}
+
+Profiler::CpuScope::CpuScope(Profiler& profiler, const std::string& name)
+    : m_profiler(profiler), m_section(profiler.beginCpu(name))
+{
+}
+
+Profiler::CpuScope::~CpuScope() {
+    m_profiler.endCpu(m_section);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// rolling statistics of one timed section, in milliseconds
+struct TimingSummary {
+    std::string name;
+    bool gpu;
+    int samples;
+    float last, average, p50, p95, p99;
+};
+
+// Per-frame CPU and GPU timings of named sections.
+// CPU sections are measured with a steady clock; a section entered several times in a frame reports
+// the sum. GPU sections are bracketed by GL_TIMESTAMP queries, which unlike GL_TIME_ELAPSED may nest.
+// The queries of a frame are read back NUM_BUFFERED_FRAMES frames later, so reading never stalls;
+// if the GPU is further behind than that, the frame's GPU samples are dropped instead.
+// The last WINDOW_SIZE samples of every section are kept for averages and percentiles, and every
+// sample can be streamed to a CSV file.
+class Profiler
+{
+public:
+    static constexpr int NUM_BUFFERED_FRAMES = 2;
+    static constexpr int WINDOW_SIZE = 240;
+
+    // GPU sections are only timed if the current context supports timer queries
+    void init();
+    void finish();
+
+    void beginFrame();
+    void endFrame();
+
+    // @return the section to pass to endCpu
+    int beginCpu(const std::string& name);
+    void endCpu(int section);
+    // GPU sections nest and must be ended in reverse order
+    void beginGpu(const std::string& name);
+    void endGpu();
+
+    // starts a new file; any open one is closed first
+    bool openCsv(const std::string& filePath);
+    void closeCsv();
+    bool isWritingCsv() const;
+
+    // sections in the order they were first timed
+    std::vector<TimingSummary> summarize() const;
+    // statistics of any series of samples (name and gpu are left empty)
+    static TimingSummary summarizeSamples(const std::vector<float>& samples);
+    // summarize() as a fixed-width table
+    std::string formatSummary() const;
+    int getDroppedGpuFrames() const;
+    // most recent sample of a section, or 0 if it was never timed
+    float getLastSample(const std::string& name, bool gpu) const;
+
+    // times a CPU section for the lifetime of the object
+    class CpuScope
+    {
+    public:
+        CpuScope(Profiler& profiler, const std::string& name);
+        ~CpuScope();
+
+    private:
+        Profiler& m_profiler;
+        int m_section;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Section {
+        std::string name;
+        bool gpu;
+        std::vector<float> window;                      // ring of the last WINDOW_SIZE samples
+        int next = 0;
+        float frameTime = 0.f;                          // accumulated in the current frame
+        bool timed = false;
+        Clock::time_point start;
+    };
+    int getSection(const std::string& name, bool gpu);
+    void addSample(Section& section, float milliseconds, int frame);
+
+    // GL_TIMESTAMP queries of one frame, a begin/end pair per timed section
+    struct GpuFrame {
+        std::vector<GLuint> queries;
+        std::vector<int> sections;
+        int used = 0;
+        int frame = -1;
+        // issued after every other query of the frame, so it completes last
+        GLuint lastQuery = 0;
+    };
+    void collectGpuFrame(GpuFrame& gpuFrame);
+
+    std::vector<Section> m_sections;
+    std::unordered_map<std::string, int> m_sectionIndices[2];  // CPU, GPU
+    bool m_gpuTiming = false;
+    GpuFrame m_gpuFrames[NUM_BUFFERED_FRAMES];
+    std::vector<int> m_gpuStack;                        // open query pairs of the current frame
+    int m_frame = 0;
+    int m_droppedGpuFrames = 0;
+
+    std::ofstream m_csv;
+};
@@ -7,6 +7,7 @@
 #include <GL/glew.h>
 #include <QFile>
 #include <QTextStream>
+#include <initializer_list>
 #include <iostream>
 
 class ShaderLoader{
@@ -16,10 +17,25 @@ public:
         GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertex_file_path);
         GLuint fragmentShaderID = createShader(GL_FRAGMENT_SHADER, fragment_file_path);
 
+        return linkProgram({vertexShaderID, fragmentShaderID});
+    }
+
+    static GLuint createShaderProgram(const char * vertex_file_path, const char * geometry_file_path, const char * fragment_file_path){
+        // Create and compile the shaders.
+        GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertex_file_path);
+        GLuint geometryShaderID = createShader(GL_GEOMETRY_SHADER, geometry_file_path);
+        GLuint fragmentShaderID = createShader(GL_FRAGMENT_SHADER, fragment_file_path);
+
+        return linkProgram({vertexShaderID, geometryShaderID, fragmentShaderID});
+    }
+
+private:
+    static GLuint linkProgram(std::initializer_list<GLuint> shaderIDs){
         // Link the shader program.
         GLuint programID = glCreateProgram();
-        glAttachShader(programID, vertexShaderID);
-        glAttachShader(programID, fragmentShaderID);
+        for (GLuint shaderID : shaderIDs) {
+            glAttachShader(programID, shaderID);
+        }
         glLinkProgram(programID);
 
         // Print the info log if error
@@ -38,26 +54,18 @@ public:
         }
 
         // Shaders no longer necessary, stored in program
-        glDeleteShader(vertexShaderID);
-        glDeleteShader(fragmentShaderID);
+        for (GLuint shaderID : shaderIDs) {
+            glDeleteShader(shaderID);
+        }
 
         return programID;
     }
 
-private:
     static GLuint createShader(GLenum shaderType, const char *filepath){
         GLuint shaderID = glCreateShader(shaderType);
 
         // Read shader file.
-        std::string code;
-        QString filepathStr = QString(filepath);
-        QFile file(filepathStr);
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream stream(&file);
-            code = stream.readAll().toStdString();
-        }else{
-            throw std::runtime_error(std::string("Failed to open shader: ")+filepath);
-        }
+        std::string code = readShaderSource(filepath);
 
         // Compile shader code.
         const char *codePtr = code.c_str();
@@ -81,4 +89,32 @@ private:
 
         return shaderID;
     }
+
+    // Reads a shader file, replacing every `#include "file"` line with the contents of that file.
+    // Included paths are relative to the directory of the including file.
+    static std::string readShaderSource(const std::string& filepath){
+        QFile file(QString::fromStdString(filepath));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            throw std::runtime_error(std::string("Failed to open shader: ")+filepath);
+        }
+
+        std::string directory = filepath.substr(0, filepath.find_last_of('/') + 1);
+        std::string code;
+        QTextStream stream(&file);
+        while (!stream.atEnd()) {
+            std::string line = stream.readLine().toStdString();
+            if (line.rfind("#include", 0) == 0) {
+                size_t open = line.find('"');
+                size_t close = line.find('"', open + 1);
+                if (open == std::string::npos || close == std::string::npos) {
+                    throw std::runtime_error("Malformed #include in shader " + filepath + ": " + line);
+                }
+                code += readShaderSource(directory + line.substr(open + 1, close - open - 1));
+            } else {
+                code += line;
+            }
+            code += '\n';
+        }
+        return code;
+    }
 };
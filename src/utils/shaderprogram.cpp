@@ -0,0 +1,177 @@
+#include "shaderprogram.h"
+
+#include <algorithm>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+/**
+ * @brief take ownership of a linked program and reflect all of its active uniforms.
+ *      Array uniforms are registered both by their base name and by every element name
+ *      (e.g. "depthTextures", "depthTextures[0]", ..., "depthTextures[7]").
+ * @param programID is a successfully linked shader program
+ */
+void ShaderProgram::init(GLuint programID) {
+    m_id = programID;
+    m_locations.clear();
+    m_shadow.clear();
+
+    GLint numUniforms = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> nameBuffer(maxNameLength + 1);
+    GLint maxLocation = -1;
+
+    for (GLuint uniformIndex = 0; uniformIndex < (GLuint)numUniforms; uniformIndex++) {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type;
+        glGetActiveUniform(m_id, uniformIndex, nameBuffer.size(), &nameLength, &arraySize, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), nameLength);
+
+        // strip the "[0]" suffix that is reported for arrays
+        std::string baseName = name;
+        if (baseName.size() > 3 && baseName.compare(baseName.size() - 3, 3, "[0]") == 0) {
+            baseName.resize(baseName.size() - 3);
+        }
+
+        for (int element = 0; element < arraySize; element++) {
+            std::string elementName = arraySize > 1 || baseName != name
+                ? baseName + "[" + std::to_string(element) + "]"
+                : name;
+            GLint location = glGetUniformLocation(m_id, elementName.c_str());
+            // uniforms that live inside a uniform block have no location
+            if (location < 0) continue;
+
+            m_locations[elementName] = location;
+            if (element == 0) {
+                m_locations[baseName] = location;
+            }
+            maxLocation = std::max(maxLocation, location);
+        }
+    }
+
+    m_shadow.resize(maxLocation + 1);
+}
+
+/**
+ * @brief delete the wrapped program.
+ */
+void ShaderProgram::finish() {
+    glDeleteProgram(m_id);
+    m_id = 0;
+    m_locations.clear();
+    m_shadow.clear();
+}
+
+GLuint ShaderProgram::getID() const {
+    return m_id;
+}
+
+void ShaderProgram::use() const {
+    glUseProgram(m_id);
+}
+
+void ShaderProgram::bindUniformBlock(const std::string& blockName, GLuint bindingPoint) const {
+    GLuint blockIndex = glGetUniformBlockIndex(m_id, blockName.c_str());
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(m_id, blockIndex, bindingPoint);
+    }
+}
+
+GLint ShaderProgram::getUniformLocation(const std::string& name) const {
+    auto it = m_locations.find(name);
+    return it == m_locations.end() ? -1 : it->second;
+}
+
+/**
+ * @brief compare a value against the shadow copy for the given location and store it.
+ * @return true if the value changed (or was never set) and must be uploaded
+ */
+bool ShaderProgram::updateShadow(GLint location, const void* data, size_t bytes) {
+    if (location < 0 || location >= (GLint)m_shadow.size()) {
+        return false;
+    }
+
+    UniformShadow& shadow = m_shadow[location];
+    if (shadow.valid && std::memcmp(shadow.data.data(), data, bytes) == 0) {
+        m_skipped++;
+        return false;
+    }
+
+    std::memcpy(shadow.data.data(), data, bytes);
+    shadow.valid = true;
+    m_uploaded++;
+    return true;
+}
+
+void ShaderProgram::setUniform(GLint location, int value) {
+    if (updateShadow(location, &value, sizeof(value))) {
+        glUniform1i(location, value);
+    }
+}
+
+void ShaderProgram::setUniform(GLint location, bool value) {
+    setUniform(location, static_cast<int>(value));
+}
+
+void ShaderProgram::setUniform(GLint location, float value) {
+    if (updateShadow(location, &value, sizeof(value))) {
+        glUniform1f(location, value);
+    }
+}
+
+void ShaderProgram::setUniform(GLint location, const glm::vec2& value) {
+    if (updateShadow(location, glm::value_ptr(value), sizeof(value))) {
+        glUniform2fv(location, 1, glm::value_ptr(value));
+    }
+}
+
+void ShaderProgram::setUniform(GLint location, const glm::vec3& value) {
+    if (updateShadow(location, glm::value_ptr(value), sizeof(value))) {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+}
+
+void ShaderProgram::setUniform(GLint location, const glm::vec4& value) {
+    if (updateShadow(location, glm::value_ptr(value), sizeof(value))) {
+        glUniform4fv(location, 1, glm::value_ptr(value));
+    }
+}
+
+void ShaderProgram::setUniform(GLint location, const glm::mat3& value) {
+    if (updateShadow(location, glm::value_ptr(value), sizeof(value))) {
+        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+void ShaderProgram::setUniform(GLint location, const glm::mat4& value) {
+    if (updateShadow(location, glm::value_ptr(value), sizeof(value))) {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+/**
+ * @brief latch the uniform counters of the previous frame and start counting again.
+ */
+void ShaderProgram::beginFrame() {
+    m_lastFrameSkipped = m_skipped;
+    m_lastFrameUploaded = m_uploaded;
+    m_skipped = 0;
+    m_uploaded = 0;
+}
+
+/**
+ * @return number of glUniform* calls skipped during the last complete frame
+ */
+int ShaderProgram::getSkippedUniformCount() const {
+    return m_lastFrameSkipped;
+}
+
+/**
+ * @return number of glUniform* calls issued during the last complete frame
+ */
+int ShaderProgram::getUploadedUniformCount() const {
+    return m_lastFrameUploaded;
+}
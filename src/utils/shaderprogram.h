@@ -0,0 +1,72 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Wraps a linked shader program (e.g. the id returned by ShaderLoader::createShaderProgram).
+// Active uniforms are reflected once at link time into a name -> location table, and the typed
+// setters keep a shadow copy of every uniform so that unchanged values are never re-uploaded.
+class ShaderProgram
+{
+public:
+    void init(GLuint programID);
+    void finish();
+
+    GLuint getID() const;
+    void use() const;
+
+    // Attaches a uniform block of this program to a buffer binding point. No-op if the block is unused.
+    void bindUniformBlock(const std::string& blockName, GLuint bindingPoint) const;
+
+    // Returns -1 if the uniform is not active in this program
+    GLint getUniformLocation(const std::string& name) const;
+
+    // Typed setters. Each one skips the glUniform* call when the value matches the shadow copy.
+    // The program must be in use (see use()) when calling these.
+    void setUniform(GLint location, int value);
+    void setUniform(GLint location, bool value);
+    void setUniform(GLint location, float value);
+    void setUniform(GLint location, const glm::vec2& value);
+    void setUniform(GLint location, const glm::vec3& value);
+    void setUniform(GLint location, const glm::vec4& value);
+    void setUniform(GLint location, const glm::mat3& value);
+    void setUniform(GLint location, const glm::mat4& value);
+
+    template <typename T>
+    void setUniform(const std::string& name, const T& value) {
+        setUniform(getUniformLocation(name), value);
+    }
+
+    // Call once at the start of every frame. The counts of the frame that just ended are kept
+    // and can be read with getSkippedUniformCount() / getUploadedUniformCount().
+    void beginFrame();
+    int getSkippedUniformCount() const;
+    int getUploadedUniformCount() const;
+
+private:
+    // Largest uniform we shadow is a mat4 (16 floats); ints are stored bit-for-bit.
+    struct UniformShadow {
+        bool valid = false;
+        std::array<GLfloat, 16> data;
+    };
+
+    bool updateShadow(GLint location, const void* data, size_t bytes);
+
+    GLuint m_id = 0;
+    std::unordered_map<std::string, GLint> m_locations;
+    std::vector<UniformShadow> m_shadow;
+
+    int m_skipped = 0;
+    int m_uploaded = 0;
+    int m_lastFrameSkipped = 0;
+    int m_lastFrameUploaded = 0;
+};
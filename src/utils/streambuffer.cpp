@@ -0,0 +1,188 @@
+#include "streambuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// how long a single glClientWaitSync may block before it is retried (1 ms)
+const GLuint64 WAIT_TIMEOUT_NS = 1000000;
+// regions start at multiples of this, which covers every uniform buffer offset alignment in practice
+const GLsizeiptr REGION_ALIGNMENT = 4096;
+
+GLsizeiptr alignUp(GLsizeiptr value, GLsizeiptr alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+/**
+ * @brief allocate the ring. Persistent mapping is used if the context supports buffer storage.
+ * @param regionSize is the number of bytes one frame may write before the buffer has to grow
+ */
+void StreamBuffer::init(GLsizeiptr regionSize) {
+    m_persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    m_frame = 0;
+    m_region = 0;
+    m_head = 0;
+    m_frameUsage = 0;
+    m_waits = 0;
+    createBuffer(alignUp(regionSize, REGION_ALIGNMENT));
+}
+
+void StreamBuffer::finish() {
+    for (GLsync& fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    for (const RetiredBuffer& retired : m_retired) {
+        glDeleteBuffers(1, &retired.buffer);
+    }
+    m_retired.clear();
+
+    if (m_mapping) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_mapping = nullptr;
+    }
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+}
+
+/**
+ * @brief create a buffer of NUM_REGIONS regions and map it if persistent mapping is used.
+ *      GL_COPY_WRITE_BUFFER is used as the target so that no binding the renderer relies on changes.
+ */
+void StreamBuffer::createBuffer(GLsizeiptr regionSize) {
+    m_regionSize = regionSize;
+    GLsizeiptr size = regionSize * NUM_REGIONS;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    if (m_persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        m_mapping = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * @brief replace the buffer by one whose regions hold at least minRegionSize bytes. The old buffer
+ *      may still be read by this frame's commands, so it is only deleted once they complete.
+ *      Writing continues at the start of the current region of the new buffer, which no earlier
+ *      frame has used.
+ */
+void StreamBuffer::grow(GLsizeiptr minRegionSize) {
+    if (m_mapping) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_mapping = nullptr;
+    }
+    m_retired.push_back({m_buffer, m_frame});
+    m_frameUsage += m_head;
+    m_head = 0;
+
+    createBuffer(alignUp(std::max(m_regionSize * 2, minRegionSize), REGION_ALIGNMENT));
+}
+
+void StreamBuffer::waitForFence(GLsync& fence) {
+    if (!fence) {
+        return;
+    }
+
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        m_waits++;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT_NS);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+/**
+ * @brief advance to the next region. Its fence was placed NUM_REGIONS frames ago, so unless the
+ *      GPU is that far behind this does not block. Once it has passed, every frame up to that one
+ *      has completed and the buffers retired by them can be deleted.
+ */
+void StreamBuffer::beginFrame() {
+    m_frame++;
+    m_region = (m_region + 1) % NUM_REGIONS;
+    m_head = 0;
+    m_frameUsage = 0;
+    waitForFence(m_fences[m_region]);
+
+    int completedFrame = m_frame - NUM_REGIONS;
+    auto completed = [&](const RetiredBuffer& retired) {
+        if (retired.frame > completedFrame) {
+            return false;
+        }
+        glDeleteBuffers(1, &retired.buffer);
+        return true;
+    };
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), completed), m_retired.end());
+}
+
+void StreamBuffer::endFrame() {
+    if (m_fences[m_region]) {
+        glDeleteSync(m_fences[m_region]);
+    }
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_lastFrameUsage = m_frameUsage + m_head;
+}
+
+/**
+ * @brief copy data to the next free (aligned) bytes of the current region. The range is known to
+ *      be unused by the GPU, so the unsynchronized map never stalls.
+ */
+GLintptr StreamBuffer::write(const void* data, GLsizeiptr size, GLsizeiptr alignment) {
+    GLintptr regionStart = m_region * m_regionSize;
+    GLintptr bufferOffset = alignUp(regionStart + m_head, alignment);
+    if (bufferOffset + size > regionStart + m_regionSize) {
+        grow(size + alignment);
+        regionStart = m_region * m_regionSize;
+        bufferOffset = alignUp(regionStart, alignment);
+    }
+    m_head = bufferOffset + size - regionStart;
+    if (size == 0) {
+        return bufferOffset;
+    }
+
+    if (m_mapping) {
+        std::memcpy(m_mapping + bufferOffset, data, size);
+    } else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        void* target = glMapBufferRange(GL_COPY_WRITE_BUFFER, bufferOffset, size, access);
+        if (target) {
+            std::memcpy(target, data, size);
+        }
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    return bufferOffset;
+}
+
+GLuint StreamBuffer::getBuffer() const {
+    return m_buffer;
+}
+
+bool StreamBuffer::isPersistent() const {
+    return m_persistent;
+}
+
+GLsizeiptr StreamBuffer::getLastFrameUsage() const {
+    return m_lastFrameUsage;
+}
+
+int StreamBuffer::getWaitCount() const {
+    return m_waits;
+}
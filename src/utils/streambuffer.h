@@ -0,0 +1,71 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <vector>
+
+// Ring buffer for data written by the CPU every frame (instance transforms, uniform blocks).
+// The buffer is split into NUM_REGIONS regions, one per frame in flight. A frame writes only to its
+// own region and fences it in endFrame(); before a region is reused, beginFrame() waits on that
+// fence. Writes therefore never need the driver to synchronize: with ARB_buffer_storage the buffer
+// stays persistently mapped, otherwise each write maps its range with GL_MAP_UNSYNCHRONIZED_BIT.
+// A frame that needs more than one region moves to a buffer twice as large.
+class StreamBuffer
+{
+public:
+    static constexpr int NUM_REGIONS = 3;
+
+    void init(GLsizeiptr regionSize);
+    void finish();
+
+    // start writing the next region, waiting for the GPU to release it if necessary
+    void beginFrame();
+    // fence every command issued since beginFrame(), which may read this frame's region
+    void endFrame();
+
+    // copy data into the current region
+    // @param alignment of the returned offset, e.g. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    // @return offset of the copy in getBuffer()
+    GLintptr write(const void* data, GLsizeiptr size, GLsizeiptr alignment = 16);
+
+    // changes when the buffer grows, so read it after the writes a draw depends on
+    GLuint getBuffer() const;
+    bool isPersistent() const;
+
+    // bytes written during the last complete frame
+    GLsizeiptr getLastFrameUsage() const;
+    // number of beginFrame() calls so far that had to wait for the GPU
+    int getWaitCount() const;
+
+private:
+    void createBuffer(GLsizeiptr regionSize);
+    void grow(GLsizeiptr minRegionSize);
+    void waitForFence(GLsync& fence);
+
+    GLuint m_buffer = 0;
+    GLsizeiptr m_regionSize = 0;
+    bool m_persistent = false;
+    // whole buffer, persistently mapped (nullptr without ARB_buffer_storage)
+    unsigned char* m_mapping = nullptr;
+
+    int m_frame = 0;
+    int m_region = 0;
+    // bytes used in the current region
+    GLsizeiptr m_head = 0;
+    // bytes written this frame to buffers replaced by grow()
+    GLsizeiptr m_frameUsage = 0;
+    GLsizeiptr m_lastFrameUsage = 0;
+    GLsync m_fences[NUM_REGIONS] = {};
+    int m_waits = 0;
+
+    // buffers replaced by a larger one; deleted once the frame that last wrote them has completed
+    struct RetiredBuffer {
+        GLuint buffer;
+        int frame;
+    };
+    std::vector<RetiredBuffer> m_retired;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// C++ mirrors of the std140 uniform blocks declared in resources/shaders/uniforms.glsl.
+// Member order and padding must match the GLSL declarations exactly.
+
+namespace UniformBlocks {
+
+const int MAX_LIGHTS = 8;
+// shadow map layers, tiles of the shadow atlas: a cascade per directional light, one per spot light
+const int MAX_SHADOW_LAYERS = 32;
+const int MAX_CASCADES = 4;
+
+const GLuint FRAME_BINDING = 0;
+const GLuint LIGHTS_BINDING = 1;
+const GLuint SHADOW_BINDING = 2;
+
+struct FrameBlock {
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::vec4 cameraPos;
+    float ka, kd, ks;
+    GLint numLights;
+    GLint shadowsEnabled;
+    GLint fogEnabled;
+    GLint pcfTaps;
+    float pcfRadius;
+};
+static_assert(sizeof(FrameBlock) == 176, "FrameBlock does not match std140 layout");
+
+struct LightEntry {
+    glm::vec4 pos;
+    glm::vec4 dir;
+    glm::vec4 color;
+    glm::vec3 attenCoeff;
+    float angle;
+    float penumbra;
+    GLint lightType;
+    GLint shadowLayer;                                  // first layer of the light's maps, -1 if none
+    GLint shadowLayerCount;
+};
+static_assert(sizeof(LightEntry) == 80, "LightEntry does not match std140 layout");
+
+struct LightsBlock {
+    LightEntry lights[MAX_LIGHTS];
+};
+
+struct ShadowBlock {
+    glm::mat4 lightVPs[MAX_SHADOW_LAYERS];
+    glm::mat4 depthBiasVPs[MAX_SHADOW_LAYERS];
+    glm::vec4 cascadeSplits;
+    glm::vec4 atlasRects[MAX_SHADOW_LAYERS];            // x, y, width, height of each layer's tile, in [0, 1]
+};
+static_assert(sizeof(ShadowBlock) == 4624, "ShadowBlock does not match std140 layout");
+
+}
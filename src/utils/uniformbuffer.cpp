@@ -0,0 +1,62 @@
+#include "uniformbuffer.h"
+
+#include <cstring>
+
+/**
+ * @brief set up the CPU copy of a block for the given uniform block binding point.
+ * @param bindingPoint shared with ShaderProgram::bindUniformBlock
+ * @param size of the std140 block in bytes
+ * @param stream provides the memory the block is bound from each frame
+ */
+void UniformBuffer::init(GLuint bindingPoint, GLsizeiptr size, StreamBuffer& stream) {
+    m_bindingPoint = bindingPoint;
+    m_contents.assign(size, 0);
+    m_valid = false;
+    m_stream = &stream;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_offsetAlignment);
+}
+
+void UniformBuffer::finish() {
+    glBindBufferBase(GL_UNIFORM_BUFFER, m_bindingPoint, 0);
+    m_stream = nullptr;
+    m_valid = false;
+}
+
+bool UniformBuffer::update(const void* data, GLsizeiptr size) {
+    if (size > (GLsizeiptr)m_contents.size()) {
+        size = m_contents.size();
+    }
+    if (m_valid && std::memcmp(m_contents.data(), data, size) == 0) {
+        return false;
+    }
+
+    std::memcpy(m_contents.data(), data, size);
+    m_valid = true;
+    m_uploads++;
+    return true;
+}
+
+/**
+ * @brief copy the block into the stream's current region. The region of an earlier frame is
+ *      recycled a few frames later, so the block is written again every frame even if unchanged.
+ */
+void UniformBuffer::bind() {
+    GLintptr offset = m_stream->write(m_contents.data(), m_contents.size(), m_offsetAlignment);
+    glBindBufferRange(GL_UNIFORM_BUFFER, m_bindingPoint, m_stream->getBuffer(), offset, m_contents.size());
+}
+
+GLuint UniformBuffer::getBindingPoint() const {
+    return m_bindingPoint;
+}
+
+void UniformBuffer::beginFrame() {
+    m_lastFrameUploads = m_uploads;
+    m_uploads = 0;
+}
+
+/**
+ * @return number of content changes during the last complete frame
+ */
+int UniformBuffer::getUploadCount() const {
+    return m_lastFrameUploads;
+}
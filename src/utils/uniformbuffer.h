@@ -0,0 +1,49 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "utils/streambuffer.h"
+
+// The contents of one uniform block binding point. The block lives in a StreamBuffer: every frame
+// bind() copies it into the frame's region and points the binding at that range, so a frame never
+// overwrites a block the GPU may still be reading.
+class UniformBuffer
+{
+public:
+    void init(GLuint bindingPoint, GLsizeiptr size, StreamBuffer& stream);
+    void finish();
+
+    // Replace the CPU copy of the block. Unchanged contents are detected and not counted as uploads.
+    // @return true if the contents changed
+    bool update(const void* data, GLsizeiptr size);
+
+    template <typename T>
+    bool update(const T& block) {
+        return update(&block, sizeof(T));
+    }
+
+    // write the block to the stream and bind it; once per frame, after the updates, before the draws
+    void bind();
+
+    GLuint getBindingPoint() const;
+
+    // Call once at the start of every frame; getUploadCount() then reports the previous frame.
+    void beginFrame();
+    int getUploadCount() const;
+
+private:
+    StreamBuffer* m_stream = nullptr;
+    GLint m_offsetAlignment = 256;
+    GLuint m_bindingPoint = 0;
+    std::vector<unsigned char> m_contents;
+    bool m_valid = false;
+
+    int m_uploads = 0;
+    int m_lastFrameUploads = 0;
+};